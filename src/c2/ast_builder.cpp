@@ -172,6 +172,11 @@ private:
             auto mx = read_expr();
             if (!mx)
                 return {};
+            // The item may have ended at the end of the read buffer.
+            if (!fr.read_ahead_at_least_1()) {
+                report_missing_char(close_char, open_char_lc);
+                return {};
+            }
             // An item must be followed by whitespace or closing char or comment.
             if (!fr.peek_wora([close_char](Utf8Char c) {
                     return c == close_char || c == COMMENT_CHAR || isspace(c.front());
@@ -8,41 +8,140 @@ namespace forrest {
 
 using absl::PrintF;
 using absl::StrFormat;
+using std::string_view;
 
 string to_string(StringTree* st, bool oneline, int indent)
 {
     CHECK(!oneline || indent == 0);
-    string text = ((st->text.empty() && st->children.empty()) ? string("\"\"") : st->text);
-    string s = string(indent, ' ') + text;
+    string s;
+    {
+        TreePrinter p(&s, oneline, indent);
+        print(st, p);
+    }
+    return s;
+}
+
+void print(const StringTree* st, TreePrinter& p)
+{
     if (st->children.empty()) {
-        if (!oneline) {
-            s += "\n";
-        }
-        return s;
+        p.leaf({st->text});
+        return;
+    }
+    p.begin_node({st->text}, st->only_leaf_children());
+    for (auto c : st->children) {
+        print(c, p);
+    }
+    p.end_node();
+}
+
+TreePrinter::TreePrinter(FILE* out, bool oneline)
+    : file(out), buffer(&file_buffer), oneline(oneline), indent(0)
+{
+    file_buffer.reserve(FLUSH_SIZE);
+}
+
+TreePrinter::TreePrinter(string* out, bool oneline, int indent)
+    : buffer(out), oneline(oneline), indent(indent)
+{}
+
+TreePrinter::~TreePrinter()
+{
+    CHECK(levels.empty());
+    flush();
+}
+
+void TreePrinter::flush()
+{
+    if (file) {
+        fwrite(buffer->data(), 1, buffer->size(), file);
+        buffer->clear();
+    }
+}
+
+void TreePrinter::write(string_view s)
+{
+    buffer->append(s);
+}
+
+void TreePrinter::newline()
+{
+    buffer->push_back('\n');
+    if (file && buffer->size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void TreePrinter::write_text(Text text)
+{
+    bool empty = true;
+    for (auto s : text) {
+        write(s);
+        empty = empty && s.empty();
     }
-    if (oneline || st->only_leaf_children()) {
-        s += text.empty() ? "{" : " {";
-        FOR (i, 0, < ~st->children) {
-            if (i > 0) {
-                s += ' ';
+    if (empty) {
+        write("\"\"");
+    }
+}
+
+void TreePrinter::begin_item()
+{
+    if (writing_oneline()) {
+        if (!levels.empty()) {
+            if (levels.back().need_space) {
+                buffer->push_back(' ');
             }
-            s += to_string(st->children[i], true);
+            levels.back().need_space = true;
         }
-        s += '}';
-        if (!oneline) {
-            s += '\n';
-        }
-        return s;
+    } else {
+        buffer->append(indent, ' ');
     }
-    s += " {\n";
-    for (auto c : st->children) {
-        s += to_string(c, false, indent + 2);
+}
+
+void TreePrinter::leaf(Text text)
+{
+    begin_item();
+    write_text(text);
+    if (!writing_oneline()) {
+        newline();
+    }
+}
+
+void TreePrinter::begin_node(Text text, bool only_leaf_children)
+{
+    begin_item();
+    bool parent_oneline = writing_oneline();
+    bool text_empty = std::all_of(BE(text), [](string_view s) { return s.empty(); });
+    for (auto s : text) {
+        write(s);
+    }
+    if (parent_oneline || only_leaf_children) {
+        write(text_empty ? "{" : " {");
+        levels.push_back(Level{true, parent_oneline, false});
+    } else {
+        write(" {\n");
+        levels.push_back(Level{false, parent_oneline, false});
+        indent += 2;
+    }
+}
+
+void TreePrinter::end_node()
+{
+    CHECK(!levels.empty());
+    auto level = levels.back();
+    levels.pop_back();
+    if (level.oneline) {
+        buffer->push_back('}');
+    } else {
+        indent -= 2;
+        buffer->append(indent, ' ');
+        buffer->push_back('}');
+    }
+    if (!level.parent_oneline) {
+        newline();
     }
-    s += string(indent, ' ') + "}\n";
-    return s;
 }
 
-const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
+const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls, bst::NodeStore& nodes)
 {
     using namespace bst;
     if (auto l = get_if<ast::List>(e)) {
@@ -67,8 +166,8 @@ const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
                         CHECK(l0.kind == ast::Token::QUOTED_STRING);
                         auto name = l0.x;
                         // 'def' doesn't introduce new lexical scope.
-                        auto body = process_ast(l->xs[2], ls);
-                        return new Def(name, body);
+                        auto body = process_ast(l->xs[2], ls, nodes);
+                        return nodes.new_<Def>(name, body);
                     }
                     case ast::Builtin::FN: {
                         // (fn pars body) where pars is list of qstrings
@@ -77,17 +176,17 @@ const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
                         CHECK(!l0.fnapp);
                         vector<FnPar> fnpars;
                         CHECK(!l0.xs.empty());
-                        vector<const Variable*> vars;
+                        vector<Variable*> vars;
                         for (auto par : l0.xs) {
                             CHECK(holds_alternative<ast::Token>(*par));
                             auto par2 = get<ast::Token>(*par);
                             CHECK(par2.kind == ast::Token::QUOTED_STRING);
-                            auto v = new Variable(par2.x);
+                            auto v = nodes.new_<Variable>(par2.x);
                             vars.emplace_back(v);
                             fnpars.emplace_back(v);
                         }
                         LexicalScope new_ls(ls, move(vars));
-                        return new Fn(fnpars, process_ast(l->xs[2], &new_ls));
+                        return nodes.new_<Fn>(fnpars, process_ast(l->xs[2], &new_ls, nodes));
                     }
                     case ast::Builtin::LET: {
                         // (let name body)
@@ -95,10 +194,10 @@ const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
                         auto l0 = get<ast::Token>(*l->xs[1]);
                         CHECK(l0.kind == ast::Token::QUOTED_STRING);
                         auto name = l0.x;
-                        LexicalScope new_ls(ls, vector<const Variable*>{new Variable(name)});
-                        auto value = process_ast(l->xs[2], &new_ls);
-                        auto body = process_ast(l->xs[3], &new_ls);
-                        return new Let(name, value, body);
+                        LexicalScope new_ls(ls, vector<Variable*>{nodes.new_<Variable>(name)});
+                        auto value = process_ast(l->xs[2], &new_ls, nodes);
+                        auto body = process_ast(l->xs[3], &new_ls, nodes);
+                        return nodes.new_<Let>(name, value, body);
                     }
                     case ast::Builtin::FNAPP:  // fnapp is implicit.
                     default:
@@ -106,20 +205,20 @@ const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
                 }
                 UL_UNREACHABLE;
             } else {
-                auto head = process_ast(l->xs[0], ls);
+                auto head = process_ast(l->xs[0], ls, nodes);
                 ys.reserve(~l->xs - 1);
                 FOR (i, 1, < ~l->xs) {
-                    ys.push_back(process_ast(l->xs[i], ls));
+                    ys.push_back(process_ast(l->xs[i], ls, nodes));
                 }
-                return new Fnapp(head, move(ys));
+                return nodes.new_<Fnapp>(head, move(ys));
             }
         } else {
             assert(!l->fnapp);
             ys.reserve(~l->xs);
             for (auto x : l->xs) {
-                ys.push_back(process_ast(x, ls));
+                ys.push_back(process_ast(x, ls, nodes));
             }
-            return new Tuple(move(ys));
+            return nodes.new_<Tuple>(move(ys));
         }
     } else {
         // Not a list, must be a token.
@@ -131,13 +230,13 @@ const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls)
                 if (auto m_v = ls->try_resolve_variable_name(t->x)) {
                     return *m_v;
                 } else {
-                    return new ToplevelVariableName(t->x);
+                    return nodes.new_<ToplevelVariableName>(t->x);
                 }
             }
             case ast::Token::QUOTED_STRING:
-                return new bst::String(t->x);
+                return nodes.new_<bst::String>(t->x);
             case ast::Token::NUMBER:
-                return new bst::Number(t->x);
+                return nodes.new_<bst::Number>(t->x);
             default:
                 UL_UNREACHABLE;
         }
@@ -306,6 +405,190 @@ void dump_dfs(const bst::Expr* expr, int indent=0)
 
 namespace bst {
 
+namespace {
+bool is_leaf(const Expr* e)
+{
+    switch (e->type) {
+        case tString:
+        case tNumber:
+        case tVariable:
+        case tToplevelVariableName:
+            return true;
+        case tTuple:
+            return cast<Tuple>(e)->xs.empty();
+        case tFnapp:
+        case tFn:
+        case tDef:
+        case tLet:
+            return false;
+    }
+    UL_UNREACHABLE;
+}
+
+string_view name_or_empty_quotes(const string& name)
+{
+    return name.empty() ? string_view("\"\"") : string_view(name);
+}
+}  // namespace
+
+void print(const Expr* e, TreePrinter& p)
+{
+    struct Printer
+    {
+        TreePrinter& p;
+        void operator()(const String* x) { p.leaf({"\"", x->x, "\""}); }
+        void operator()(const Number* x) { p.leaf({"#", x->x}); }
+        void operator()(const Variable* x) { p.leaf({x->name}); }
+        void operator()(const ToplevelVariableName* x) { p.leaf({"<tlvar> ", x->name}); }
+        void operator()(const Fnapp* x)
+        {
+            bool only_leaves = is_leaf(x->fn_to_apply) &&
+                               std::all_of(BE(x->args), [](const Expr* a) { return is_leaf(a); });
+            p.begin_node({"<fnapp>"}, only_leaves);
+            visit(*this, x->fn_to_apply);
+            for (auto a : x->args) {
+                visit(*this, a);
+            }
+            p.end_node();
+        }
+        void operator()(const Fn* x)
+        {
+            p.begin_node({"<fn>"}, false);
+            p.begin_node({}, true);
+            for (auto par : x->pars) {
+                p.leaf({par->name});
+            }
+            p.end_node();
+            visit(*this, x->body);
+            p.end_node();
+        }
+        void operator()(const Def* x)
+        {
+            p.begin_node({"<def> ", name_or_empty_quotes(x->name)}, is_leaf(x->e));
+            visit(*this, x->e);
+            p.end_node();
+        }
+        void operator()(const Let* x)
+        {
+            p.begin_node({"<let> ", name_or_empty_quotes(x->name)},
+                         is_leaf(x->value) && is_leaf(x->body));
+            visit(*this, x->value);
+            visit(*this, x->body);
+            p.end_node();
+        }
+        void operator()(const Tuple* x)
+        {
+            if (x->xs.empty()) {
+                p.leaf({"<tuple>"});
+                return;
+            }
+            if (x->has_names) {
+                p.begin_node({"<tuple>"}, false);
+                for (auto& ne : x->xs) {
+                    p.begin_node({ne.n}, is_leaf(ne.x));
+                    visit(*this, ne.x);
+                    p.end_node();
+                }
+            } else {
+                p.begin_node({"<tuple>"}, std::all_of(BE(x->xs), [](const NamedExpr& ne) {
+                                 return is_leaf(ne.x);
+                             }));
+                for (auto& ne : x->xs) {
+                    visit(*this, ne.x);
+                }
+            }
+            p.end_node();
+        }
+    };
+    visit(Printer{p}, e);
+}
+
+string structural_key(const Expr* e)
+{
+    struct Serializer
+    {
+        string s;
+        void add(const void* p, size_t n) { s.append(static_cast<const char*>(p), n); }
+        void add(int x) { add(&x, sizeof(x)); }
+        void add(const string& s)
+        {
+            add(~s);
+            add(s.data(), s.size());
+        }
+        void add(const Expr* x)
+        {
+            add(int(x->type));
+            visit(*this, x);
+        }
+        void operator()(const String* x) { add(x->x); }
+        void operator()(const Number* x) { add(x->x); }
+        void operator()(const Variable* x)
+        {
+            add(x->depth);
+            add(x->slot);
+        }
+        void operator()(const ToplevelVariableName* x) { add(x->name); }
+        void operator()(const Fnapp* x)
+        {
+            add(x->fn_to_apply);
+            add(~x->args);
+            for (auto a : x->args) {
+                add(a);
+            }
+        }
+        void operator()(const Fn* x)
+        {
+            add(~x->pars);
+            add(x->body);
+        }
+        void operator()(const Def* x)
+        {
+            add(x->name);
+            add(x->e);
+        }
+        void operator()(const Let* x)
+        {
+            add(x->value);
+            add(x->body);
+        }
+        void operator()(const Tuple* x)
+        {
+            add(~x->xs);
+            add(int(x->has_names));
+            for (auto& ne : x->xs) {
+                add(ne.n);
+                add(ne.x);
+            }
+        }
+    };
+    Serializer serializer;
+    serializer.add(e);
+    return move(serializer.s);
+}
+
+LexicalScope::LexicalScope() : owned_table(new Table), table(owned_table.get()) {}
+
+LexicalScope::LexicalScope(const LexicalScope* enclosing, vector<Variable*> vars)
+    : enclosing(enclosing), depth(enclosing->depth + 1), vs(BE(vars)), table(enclosing->table)
+{
+    FOR (i, 0, < ~vars) {
+        vars[i]->depth = depth;
+        vars[i]->slot = i;
+        (*table)[vars[i]->name].push_back(vars[i]);
+    }
+}
+
+LexicalScope::~LexicalScope()
+{
+    for (auto v : vs) {
+        auto it = table->find(v->name);
+        it->second.pop_back();
+        if (it->second.empty()) {
+            table->erase(it);
+        }
+    }
+}
+
 #if 0
 string to_string(const Instr& x)
 {
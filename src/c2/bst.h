@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
 #include <typeindex>
+#include <unordered_map>
 
 #include "ast.h"
 #include "ast_syntax.h"
@@ -31,6 +37,51 @@ struct StringTree
 
 string to_string(StringTree* st, bool oneline = true, int indent = 0);
 
+// Writes the layout of to_string(StringTree*) into a string or, through a fixed-size buffer, into
+// a FILE* without building the StringTree. A node with children is written between begin_node()
+// and end_node(), the caller tells in advance whether all its children are leaves.
+class TreePrinter
+{
+public:
+    using Text = std::initializer_list<std::string_view>;  // Concatenated.
+
+    TreePrinter(FILE* out, bool oneline);
+    TreePrinter(string* out, bool oneline, int indent = 0);
+    ~TreePrinter();
+    TreePrinter(const TreePrinter&) = delete;
+    TreePrinter& operator=(const TreePrinter&) = delete;
+
+    void leaf(Text text);
+    void begin_node(Text text, bool only_leaf_children);
+    void end_node();
+    void flush();
+
+private:
+    static const size_t FLUSH_SIZE = 64 * 1024;
+
+    struct Level
+    {
+        bool oneline;         // Children are written on this line.
+        bool parent_oneline;  // This node is written on its parent's line.
+        bool need_space;
+    };
+
+    FILE* file = nullptr;
+    string file_buffer;
+    string* buffer;
+    const bool oneline;
+    int indent;
+    vector<Level> levels;
+
+    bool writing_oneline() const { return levels.empty() ? oneline : levels.back().oneline; }
+    void begin_item();
+    void write_text(Text text);
+    void write(std::string_view s);
+    void newline();
+};
+
+void print(const StringTree* st, TreePrinter& p);
+
 namespace bst {
 
 struct Fn;
@@ -53,31 +104,49 @@ struct Expr
     Type type;
     explicit Expr(Type type) : type(type) {}
     virtual ~Expr() {}
-    virtual StringTree* to_stringtree() const = 0;
+};
+
+// Owns the nodes built by process_ast(), they are freed with it.
+class NodeStore
+{
+    vector<std::unique_ptr<Expr>> nodes;
+
+public:
+    template <class T, class... Args>
+    T* new_(Args&&... args)
+    {
+        auto p = new T(std::forward<Args>(args)...);
+        nodes.emplace_back(p);
+        return p;
+    }
 };
 
 struct String : Expr
 {
+    static constexpr Type TYPE = tString;
     string x;
-    explicit String(string x) : Expr(tString), x(move(x)) {}
-    virtual StringTree* to_stringtree() const { return new StringTree("\"" + x + "\""); }
+    explicit String(string x) : Expr(TYPE), x(move(x)) {}
 };
 
 struct Number : Expr
 {
+    static constexpr Type TYPE = tNumber;
     string x;
-    explicit Number(string x) : Expr(tNumber), x(move(x)) {}
-    virtual StringTree* to_stringtree() const { return new StringTree("#" + x); }
+    explicit Number(string x) : Expr(TYPE), x(move(x)) {}
 };
 
 struct Variable : Expr
 {
+    static constexpr Type TYPE = tVariable;
+    static const int NO_COORD = -1;
+
     string name;
-    explicit Variable(string name) : Expr(tVariable), name(move(name)) {}
-    virtual StringTree* to_stringtree() const
-    {
-        return new StringTree(name.empty() ? string("\"\"") : name);
-    }
+    // Set when the variable is bound by a LexicalScope: `depth` is the number of scopes enclosing
+    // the binding scope and `slot` is the index of the variable in it. Toplevel variables have
+    // no coordinates.
+    int depth = NO_COORD;
+    int slot = NO_COORD;
+    explicit Variable(string name) : Expr(TYPE), name(move(name)) {}
 };
 
 /*
@@ -103,101 +172,86 @@ string to_string(const Instr& x);
 
 struct Fnapp : Expr
 {
+    static constexpr Type TYPE = tFnapp;
     const Expr* const fn_to_apply;
     const vector<const Expr*> args;
     Fnapp(const Expr* fn_to_apply, vector<const Expr*> args)
-        : Expr(tFnapp), fn_to_apply(fn_to_apply), args(move(args))
+        : Expr(TYPE), fn_to_apply(fn_to_apply), args(move(args))
     {
         CHECK(!this->args.empty());
     }
-    virtual StringTree* to_stringtree() const
-    {
-        vector<StringTree*> children = {fn_to_apply->to_stringtree()};
-        for (auto a : args) {
-            children.emplace_back(a->to_stringtree());
-        }
-        return new StringTree("<fnapp>", move(children));
-    }
 };
 
+// Scopes are created and destroyed in LIFO order while process_ast descends. All scopes of a chain
+// share a table from name to the stack of variables bound to that name, so resolving a name is a
+// single hash lookup regardless of how deeply it's nested.
 struct LexicalScope
 {
+    using Table = std::unordered_map<string, vector<const Variable*>>;
+
     const maybe<const LexicalScope*> enclosing;
+    const int depth = 0;
     const vector<const Variable*> vs;
-    LexicalScope() = default;
-    LexicalScope(const LexicalScope* enclosing, vector<const Variable*> vs)
-        : enclosing(enclosing), vs(move(vs))
-    {
-        CHECK(enclosing);
-    }
+
+    LexicalScope();
+    // Binds `vs` and assigns their (depth, slot) coordinates.
+    LexicalScope(const LexicalScope* enclosing, vector<Variable*> vars);
+    ~LexicalScope();
+    LexicalScope(const LexicalScope&) = delete;
+    LexicalScope& operator=(const LexicalScope&) = delete;
+
     maybe<const Variable*> try_resolve_variable_name(const string& s) const
     {
-        for (auto v : vs) {
-            if (v->name == s) {
-                return v;
-            }
+        auto it = table->find(s);
+        if (it == table->end()) {
+            return {};
         }
-        if (enclosing) {
-            return (*enclosing)->try_resolve_variable_name(s);
-        }
-        return {};
+        return it->second.back();
     }
+
+private:
+    std::unique_ptr<Table> owned_table;  // Only the root scope owns the table.
+    Table* const table;
 };
 
 struct ToplevelVariableName : Expr
 {
+    static constexpr Type TYPE = tToplevelVariableName;
     const string name;
-    ToplevelVariableName(string name) : Expr(tToplevelVariableName), name(move(name)) {}
-    virtual StringTree* to_stringtree() const { return new StringTree("<tlvar> " + name); }
+    ToplevelVariableName(string name) : Expr(TYPE), name(move(name)) {}
 };
 
 using FnPar = const Variable*;
 
 struct Fn : Expr
 {
+    static constexpr Type TYPE = tFn;
     using Pars = vector<FnPar>;
     Pars pars;
     const Expr* body;
-    Fn(Pars pars, const Expr* body) : Expr(tFn), pars(move(pars)), body(body)
+    Fn(Pars pars, const Expr* body) : Expr(TYPE), pars(move(pars)), body(body)
     {
         CHECK(!this->pars.empty());
     }
-    virtual StringTree* to_stringtree() const
-    {
-        vector<StringTree*> stpars, children;
-        for (auto& p : pars) {
-            stpars.emplace_back(new StringTree(p->name));
-        }
-        children = {new StringTree(move(stpars)), body->to_stringtree()};
-        return new StringTree("<fn>", children);
-    }
 };
 
 struct Def : Expr
 {
+    static constexpr Type TYPE = tDef;
     string name;
     const Expr* e;
-    Def(string name, const Expr* e) : Expr(tDef), name(move(name)), e(e) {}
-    virtual StringTree* to_stringtree() const
-    {
-        return new StringTree("<def> " + (name.empty() ? string("\"\"") : name),
-                              vector<StringTree*>{e->to_stringtree()});
-    }
+    Def(string name, const Expr* e) : Expr(TYPE), name(move(name)), e(e) {}
 };
 
 struct Let : Expr
 {
+    static constexpr Type TYPE = tLet;
     string name;
     const Expr* value;
     const Expr* body;
     Let(string name, const Expr* value, const Expr* body)
-        : Expr(tLet), name(move(name)), value(value), body(body)
+        : Expr(TYPE), name(move(name)), value(value), body(body)
     {}
-    virtual StringTree* to_stringtree() const
-    {
-        return new StringTree("<let> " + (name.empty() ? string("\"\"") : name),
-                              vector<StringTree*>{value->to_stringtree(), body->to_stringtree()});
-    }
 };
 
 struct NamedExpr
@@ -212,35 +266,21 @@ vector<NamedExpr> vector_expr_to_vector_namedexpr(const vector<const Expr*>& xs)
 
 struct Tuple : Expr
 {
+    static constexpr Type TYPE = tTuple;
     const vector<NamedExpr> xs;
     const bool has_names;
 
-    Tuple() : Expr(tTuple), has_names(false) {}
+    Tuple() : Expr(TYPE), has_names(false) {}
     explicit Tuple(vector<const Expr*> xs)
-        : Expr(tTuple), xs(vector_expr_to_vector_namedexpr(xs)), has_names(false)
+        : Expr(TYPE), xs(vector_expr_to_vector_namedexpr(xs)), has_names(false)
     {}
     explicit Tuple(vector<NamedExpr> xs)
-        : Expr(tTuple),
+        : Expr(TYPE),
           xs(move(xs)),
           has_names(std::any_of(BE(xs), [](auto& ne) { return !ne.n.empty(); }))
     {}
     const Expr* operator[](int i) const { return xs[i].x; }
     int size() const { return ~xs; }
-    virtual StringTree* to_stringtree() const
-    {
-        vector<StringTree*> children;
-        if (has_names) {
-            for (auto x : xs) {
-                children.emplace_back(
-                    new StringTree(x.n, vector<StringTree*>{x.x->to_stringtree()}));
-            }
-        } else {
-            for (auto x : xs) {
-                children.emplace_back(x.x->to_stringtree());
-            }
-        }
-        return new StringTree("<tuple>", children);
-    }
 };
 
 /*
@@ -280,34 +320,71 @@ chain. const TupleChain dynamic_chain;  // Callees inherit callers' dynamic scop
 };
 */
 
+// The casts and visit() dispatch on Expr::type instead of RTTI, they're called on every node in
+// the traversals.
+
 template <class T>
-const T* cast(const Expr* e)
+const T* try_cast(const Expr* e)
 {
-    const T* t = dynamic_cast<const T*>(e);
-    CHECK(t);
-    return t;
+    return e->type == T::TYPE ? static_cast<const T*>(e) : nullptr;
 }
 
 template <class T>
-T* cast(Expr* e)
+T* try_cast(Expr* e)
 {
-    T* t = dynamic_cast<T*>(e);
-    CHECK(t);
-    return t;
+    return e->type == T::TYPE ? static_cast<T*>(e) : nullptr;
 }
 
 template <class T>
-const T* try_cast(const Expr* e)
+const T* cast(const Expr* e)
 {
-    return dynamic_cast<const T*>(e);
+    CHECK(e->type == T::TYPE);
+    return static_cast<const T*>(e);
 }
 
 template <class T>
-T* try_cast(Expr* e)
+T* cast(Expr* e)
 {
-    return dynamic_cast<T*>(e);
+    CHECK(e->type == T::TYPE);
+    return static_cast<T*>(e);
 }
 
+// Call `f` with `e` cast to its concrete type. `f` must accept all of them: a missing overload
+// doesn't compile and a missing case is reported by -Wswitch.
+template <class F>
+decltype(auto) visit(F&& f, const Expr* e)
+{
+    switch (e->type) {
+        case tString:
+            return f(static_cast<const String*>(e));
+        case tNumber:
+            return f(static_cast<const Number*>(e));
+        case tTuple:
+            return f(static_cast<const Tuple*>(e));
+        case tVariable:
+            return f(static_cast<const Variable*>(e));
+        case tFnapp:
+            return f(static_cast<const Fnapp*>(e));
+        case tFn:
+            return f(static_cast<const Fn*>(e));
+        case tDef:
+            return f(static_cast<const Def*>(e));
+        case tLet:
+            return f(static_cast<const Let*>(e));
+        case tToplevelVariableName:
+            return f(static_cast<const ToplevelVariableName*>(e));
+    }
+    UL_UNREACHABLE;
+}
+
+// Same layout as the StringTree the Expr used to be converted to.
+void print(const Expr* e, TreePrinter& p);
+
+// Binary serialization of the structure of `e`, stable across runs, equal keys mean equal
+// structures. Variables are written as their (depth, slot) coordinates, so renaming a parameter
+// doesn't change the key.
+string structural_key(const Expr* e);
+
 }  // namespace bst
 
 /*
@@ -322,7 +399,7 @@ struct Bst
 };
 
  */
-const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls);
+const bst::Expr* process_ast(ast::Expr* e, const bst::LexicalScope* ls, bst::NodeStore& nodes);
 // void dump(const bst::Expr* expr);
 // void dump_dfs(const bst::Expr* expr);
 maybe<const bst::Expr*> lookup_by_name(const bst::Tuple* t, const string& n);
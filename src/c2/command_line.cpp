@@ -7,6 +7,36 @@ namespace forrest {
 
 using namespace ul;
 
+namespace {
+
+// Reads the path after the option at argv[i] into `path`, advances `i` to it.
+bool parse_path(int argc, const char* argv[], int& i, string& path)
+{
+    if (++i == argc) {
+        fprintf(stderr, "Missing path for %s", argv[i - 1]);
+        return false;
+    }
+    path = argv[i];
+    return true;
+}
+
+// Reads the positive number after the option at argv[i] into `n`, advances `i` to it.
+bool parse_count(int argc, const char* argv[], int& i, int& n)
+{
+    auto option = argv[i];
+    n = 0;
+    if (++i < argc) {
+        n = atoi(argv[i]);
+    }
+    if (n <= 0) {
+        fprintf(stderr, "Missing or invalid number for %s", option);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
 maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[])
 {
     CommandLineOptions cl;
@@ -16,12 +46,33 @@ maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[])
             a += 2;
             if (startswith(a, "help")) {
                 cl.help = true;
+            } else if (startswith(a, "cpp-shards")) {
+                if (!parse_count(argc, argv, i, cl.cpp_shards)) {
+                    return {};
+                }
+            } else if (startswith(a, "jobs")) {
+                if (!parse_count(argc, argv, i, cl.jobs)) {
+                    return {};
+                }
+            } else if (startswith(a, "check")) {
+                cl.check_only = true;
+            } else if (startswith(a, "time-report")) {
+                cl.time_report = true;
             } else if (startswith(a, "cpp-out")) {
-                if (++i == argc) {
-                    fprintf(stderr, "Missing path for --cpp-out");
+                if (!parse_path(argc, argv, i, cl.cpp_out)) {
+                    return {};
+                }
+            } else if (startswith(a, "server")) {
+                if (!parse_path(argc, argv, i, cl.server_socket)) {
+                    return {};
+                }
+            } else if (startswith(a, "connect")) {
+                if (!parse_path(argc, argv, i, cl.connect_socket)) {
+                    return {};
+                }
+            } else if (startswith(a, "trace-out")) {
+                if (!parse_path(argc, argv, i, cl.trace_out)) {
                     return {};
-                } else {
-                    cl.cpp_out = argv[i];
                 }
             } else {
                 fprintf(stderr, "invalid option: '%s'", argv[i]);
@@ -16,6 +16,13 @@ struct CommandLineOptions
     bool help = false;
     vector<string> files;
     string cpp_out;
+    int cpp_shards = 1;        // Number of translation units written.
+    int jobs = 0;              // Code generation threads, 0 means one per hardware thread.
+    bool check_only = false;   // Stop after binding the names.
+    string server_socket;      // Run as compile server on this socket.
+    string connect_socket;     // Forward the command line to the compile server on this socket.
+    bool time_report = false;  // Print the time spent in the phases to stderr.
+    string trace_out;          // Write a Chrome trace of the phases to this path.
 };
 
 maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[]);
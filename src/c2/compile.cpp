@@ -0,0 +1,157 @@
+#include "compile.h"
+
+#include <map>
+
+#include "absl/strings/str_format.h"
+#include "ast_builder.h"
+#include "command_line.h"
+#include "cppgen.h"
+#include "cst.h"
+#include "ul/check.h"
+#include "ul/usual.h"
+#include "util/filereader.h"
+#include "util/log.h"
+#include "util/timing.h"
+
+namespace forrest {
+
+using absl::PrintF;
+using std::map;
+using std::move;
+
+using namespace ul;
+
+void begin_timing(const CommandLineOptions& o)
+{
+    if (o.time_report || !o.trace_out.empty()) {
+        enable_timing();
+    }
+}
+
+bool end_timing(const CommandLineOptions& o)
+{
+    if (!g_timing.enabled) {
+        return true;
+    }
+    disable_timing();
+    if (o.time_report) {
+        print_time_report(stderr);
+    }
+    return o.trace_out.empty() || write_chrome_trace(o.trace_out);
+}
+
+namespace {
+maybe<SourceFile> parse_file_reader(const string& path, either<string, FileReader> lr)
+{
+    TIME_SCOPE("parse_source_file");
+    if (is_left(lr)) {
+        report_error(left(lr));
+        return {};
+    }
+    SourceFile sf;
+    sf.path = path;
+    sf.ast = std::make_unique<Ast>();
+    // Call AstBuilder with new FileReader.
+    auto plr = [&]() {
+        TIME_SCOPE("parse and build ast");
+        return AstBuilder::parse_filereader_into_ast(right(lr), *sf.ast);
+    }();
+    if (is_left(plr)) {
+        report_error(left(plr));
+        return {};
+    }
+    sf.top_level_exprs = move(right(plr));
+    TIME_SCOPE("process_ast");
+    bst::LexicalScope ls_root;
+    for (auto x : sf.top_level_exprs) {
+        sf.top_level_bexprs.push_back(process_ast(x, &ls_root, sf.bst_nodes));
+    }
+    return sf;
+}
+}  // namespace
+
+maybe<SourceFile> parse_source_file(const string& path)
+{
+    return parse_file_reader(path, FileReader::new_(path));
+}
+
+maybe<SourceFile> parse_source_file(const string& path, const string& content)
+{
+    return parse_file_reader(path, FileReader::new_from_memory(content, path));
+}
+
+int compile_source_files(const vector<const SourceFile*>& files, const CommandLineOptions& o)
+{
+    // Dump top level expressions.
+    {
+        TIME_SCOPE("dump");
+        int n_dumped = 0;
+        for (auto f : files) {
+            for (auto x : f->top_level_exprs) {
+                PrintF("-- TOP LEVEL #%d\n", n_dumped++);
+                dump(x);
+            }
+        }
+    }
+    // Process top-level expressions.
+    using namespace bst;
+    map<string, pair<const Variable*, const Expr*>> toplevel_variables;
+    vector<const Def*> toplevel_defs;
+    for (auto f : files) {
+        for (auto x : f->top_level_bexprs) {
+            switch (x->type) {
+                case tDef: {
+                    auto d = cast<Def>(x);
+                    CHECK(toplevel_variables.count(d->name) == 0);
+                    auto v = new bst::Variable(d->name);
+                    toplevel_variables[d->name] = make_pair(v, d->e);
+                    toplevel_defs.push_back(d);
+                } break;
+
+                default:
+                    UL_UNREACHABLE;
+                    break;
+            }
+        }
+    }
+    if (o.check_only) {
+        return EXIT_SUCCESS;
+    }
+
+    const string ENTRY_POINT = "main";
+    auto it = toplevel_variables.find(ENTRY_POINT);
+    CHECK(it != toplevel_variables.end(), "No entry point found");
+    auto var_expr = it->second;
+    {
+        TreePrinter p(stdout, false);
+        print(var_expr.SND, p);
+    }
+    PrintF("\n");
+    // Call the entry point function, will be called with unit arg.
+    {
+        TIME_SCOPE("compile_function");
+        compile_function(var_expr.SND, {&bst::EXPR_EMPTY_TUPLE});
+    }
+    /*
+        Shell shell;
+        for (auto x : top_level_exprs) {
+            auto lr = shell.eval(x);
+            if (is_left(lr)) {
+                fprintf(stderr, "Error: %s\n", left(lr).msg.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+
+        for (auto& kv : shell.symbols) {
+            auto& s = kv.first;
+            auto& v = kv.second;
+            int a = 3;
+        }
+    */
+    if (!o.cpp_out.empty() && !cppgen(toplevel_defs, o)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+}  // namespace forrest
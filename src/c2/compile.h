@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "bst.h"
+#include "ul/maybe.h"
+
+namespace forrest {
+
+struct CommandLineOptions;
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using ul::maybe;
+
+// Parsed and bound top-level expressions of an input file.
+struct SourceFile
+{
+    string path;
+    unique_ptr<Ast> ast;
+    vector<ast::Expr*> top_level_exprs;
+    vector<const bst::Expr*> top_level_bexprs;
+    bst::NodeStore bst_nodes;  // Nodes of top_level_bexprs.
+};
+
+// Errors are reported to stderr.
+maybe<SourceFile> parse_source_file(const string& path);
+// Parses `content`, read from `path` earlier.
+maybe<SourceFile> parse_source_file(const string& path, const string& content);
+
+// Enable the timers if `o` asks for a time report or a trace.
+void begin_timing(const CommandLineOptions& o);
+// Print the time report and write the trace, if asked for. Returns false on I/O error.
+bool end_timing(const CommandLineOptions& o);
+
+// Everything after parsing: dump, look up the entry point, compile and generate C++. With
+// `o.check_only` stops after binding the names.
+int compile_source_files(const vector<const SourceFile*>& files, const CommandLineOptions& o);
+
+}  // namespace forrest
@@ -1,185 +1,461 @@
-#if 0
 #include "cppgen.h"
 
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
 #include "absl/strings/str_format.h"
 #include "ul/usual.h"
+#include "util/arena.h"
+#include "util/timing.h"
 
-#include "util/maybe.h"
-#include "util/utf.h"
-
-#include "ast.h"
+#include "command_line.h"
 
 namespace forrest {
 
-using std::get_if;
-using std::holds_alternative;
-using std::in_place_type;
-
+using absl::StrAppendFormat;
 using absl::StrFormat;
 
+using std::string_view;
+using std::unordered_map;
+
 using namespace ul;
 
-const char* node_type_name(const Expr& e)
+namespace {
+
+const char* const GENERATED_NAMESPACE = "forrest_gen";
+
+// Minimal dynamic runtime the generated code is written against.
+const char* const HEADER_PRELUDE = R"~~~~(// Generated by c2, do not edit.
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace forrest_gen {
+
+struct Value;
+using Ref = std::shared_ptr<const Value>;
+using Args = std::vector<Ref>;
+
+struct Value
 {
-    struct Visitor
-    {
-        auto operator()(const TupleNode&) { return "vector"; }
-        auto operator()(const StrNode& x) { return "string"; }
-        auto operator()(const SymLeaf& x) { return "symbol"; }
-        auto operator()(const NumLeaf& x) { return "number"; }
-        auto operator()(const CharLeaf& x) { return "char"; }
-        auto operator()(const VoidLeaf& x) { return "void"; }
-        auto operator()(const ApplyNode& x) { return "apply"; }
-        auto operator()(const QuoteNode& x) { return "quote"; }
-    };
-    return std::visit(Visitor{}, e);
+    std::string text;  // String or number.
+    Args xs;           // Tuple.
+    std::function<Ref(const Args&)> fn;
+};
+
+inline Ref str(const char* s)
+{
+    return std::make_shared<const Value>(Value{s, {}, {}});
 }
+inline Ref num(const char* s)
+{
+    return std::make_shared<const Value>(Value{s, {}, {}});
+}
+inline Ref tuple(Args xs)
+{
+    return std::make_shared<const Value>(Value{{}, std::move(xs), {}});
+}
+inline Ref fn(std::function<Ref(const Args&)> f)
+{
+    return std::make_shared<const Value>(Value{{}, {}, std::move(f)});
+}
+inline Ref apply(const Ref& f, const Args& args)
+{
+    if (!f || !f->fn) {
+        throw std::runtime_error("Applying a value which is not a function.");
+    }
+    return f->fn(args);
+}
+
+)~~~~";
 
-string to_string(Expr* e)
+// Letters and digits are kept, everything else is hex-escaped after an underscore, so distinct
+// names give distinct identifiers.
+string mangle(const string& name)
 {
-    struct Visitor
+    string s;
+    for (unsigned char c : name) {
+        if (isalnum(c)) {
+            s += c;
+        } else {
+            StrAppendFormat(&s, "_%02x", c);
+        }
+    }
+    return s;
+}
+
+string def_function_name(const string& name)
+{
+    return "d_" + mangle(name);
+}
+
+string c_string_literal(const string& x)
+{
+    string s = "\"";
+    for (unsigned char c : x) {
+        if (c == '"' || c == '\\') {
+            s += '\\';
+            s += c;
+        } else if (isprint(c)) {
+            s += c;
+        } else {
+            StrAppendFormat(&s, "\\%03o", c);
+        }
+    }
+    s += '"';
+    return s;
+}
+
+// Generates the C++ expression of a bst::Expr. Parameters and let-bound variables are named by
+// their (depth, slot) coordinates. The partial results are strings in `scratch`, they are only
+// copied into the caller's buffers once the definition is complete.
+struct ExprGen
+{
+    Arena& scratch;
+    int depth = 0;  // Number of scopes, see bst::LexicalScope.
+    string error;
+
+    explicit ExprGen(Arena& scratch) : scratch(scratch) {}
+
+    string_view cat(const string_view* first, const string_view* last)
     {
-        string s;
-        void operator()(const TupleNode& x, char open_char = '(', char close_char = ')')
-        {
-            s += open_char;
-            bool first = true;
-            for (auto& i : x.xs) {
-                if (first) {
-                    first = false;
-                    s += ' ';
-                }
-                visit(*this, *i);
-            }
-            s += close_char;
+        size_t size = 0;
+        for (auto p = first; p != last; ++p) {
+            size += p->size();
         }
-        void operator()(const StrNode& x)
-        {
-            s += '"';
-            for (auto c : x.xs) {
-                if (!iscntrl(c) && is_ascii_utf8_byte(c))
-                    s += c;
-                else {
-                    s += StrFormat("\\U+%02X;", c);
-                }
-            }
-            s += '"';
+        auto s = (char*)scratch.allocate_block(size, 1);
+        auto q = s;
+        for (auto p = first; p != last; ++p) {
+            memcpy(q, p->data(), p->size());
+            q += p->size();
         }
-        void operator()(const SymLeaf& x)
-        {
-            s += StrFormat("%s", x.name);
+        return string_view(s, size);
+    }
+    string_view cat(std::initializer_list<string_view> xs) { return cat(xs.begin(), xs.end()); }
+
+    string_view var_name(const bst::Variable* v)
+    {
+        CHECK(v->depth != bst::Variable::NO_COORD);
+        return cat({StrFormat("v_%d_%d", v->depth, v->slot)});
+    }
+    string_view args(const vector<const bst::Expr*>& xs)
+    {
+        vector<string_view> parts;
+        parts.reserve(2 * ~xs + 1);
+        parts.push_back("{");
+        FOR (i, 0, < ~xs) {
+            if (i > 0) {
+                parts.push_back(", ");
+            }
+            parts.push_back(bst::visit(*this, xs[i]));
         }
-        void operator()(const NumLeaf& x) { s += StrFormat("%s", x.x); }
-        void operator()(const CharLeaf& x)
-        {
-            s += StrFormat("%s", utf32_to_descriptive_string(x.x));
+        parts.push_back("}");
+        return cat(parts.data(), parts.data() + parts.size());
+    }
+    string_view operator()(const bst::String* x)
+    {
+        return cat({"str(", c_string_literal(x->x), ")"});
+    }
+    string_view operator()(const bst::Number* x)
+    {
+        return cat({"num(", c_string_literal(x->x), ")"});
+    }
+    string_view operator()(const bst::Variable* x) { return var_name(x); }
+    string_view operator()(const bst::ToplevelVariableName* x)
+    {
+        return cat({def_function_name(x->name), "()"});
+    }
+    string_view operator()(const bst::Tuple* x)
+    {
+        vector<const bst::Expr*> xs;
+        xs.reserve(~x->xs);
+        for (auto& ne : x->xs) {
+            xs.push_back(ne.x);
         }
-        void operator()(const VoidLeaf& x) {}
-        void operator()(const ApplyNode& x) { (*this)(*x.tuple_ref, '{', '}'); }
-        void operator()(const QuoteNode& x)
-        {
-            s += '`';
-            visit(*this, *x.expr_ref);
+        return cat({"tuple(", args(xs), ")"});
+    }
+    string_view operator()(const bst::Fnapp* x)
+    {
+        return cat({"apply(", bst::visit(*this, x->fn_to_apply), ", ", args(x->args), ")"});
+    }
+    string_view operator()(const bst::Fn* x)
+    {
+        vector<string_view> parts;
+        parts.reserve(~x->pars + 3);
+        parts.push_back(cat({StrFormat(
+            "fn([=](const Args& a) -> Ref { if (a.size() != %d) { throw "
+            "std::runtime_error(\"Wrong number of arguments.\"); } ",
+            ~x->pars)}));
+        FOR (i, 0, < ~x->pars) {
+            parts.push_back(
+                cat({StrFormat("const Ref %s = a[%d]; ", var_name(x->pars[i]), i)}));
         }
-    } visitor;
+        ++depth;
+        parts.push_back("return ");
+        parts.push_back(bst::visit(*this, x->body));
+        parts.push_back("; })");
+        --depth;
+        return cat(parts.data(), parts.data() + parts.size());
+    }
+    string_view operator()(const bst::Let* x)
+    {
+        // Let doesn't keep its Variable, but it's the only one in a new scope. The name is bound
+        // in the value too, a self-reference sees an empty Ref.
+        ++depth;
+        auto v = StrFormat("v_%d_0", depth);
+        auto value = bst::visit(*this, x->value);
+        auto body = bst::visit(*this, x->body);
+        auto s = cat({"[&]() -> Ref { Ref ", v, "; ", v, " = ", value, "; return ", body, "; }()"});
+        --depth;
+        return s;
+    }
+    string_view operator()(const bst::Def* x)
+    {
+        error = StrFormat("def `%s` is not at top level", x->name);
+        return "nullptr";
+    }
+};
 
-    if (auto str = get_if<StrNode>(e)) {
-        return str->xs;
+struct GeneratedDef
+{
+    string key;  // structural_key() of the definition.
+    string code;
+    string error;
+};
+
+// Runs on the cppgen workers, the temporaries go to the worker's thread-local arena and are
+// released when the definition is done.
+GeneratedDef generate_def(const bst::Def* d, string key)
+{
+    auto& scratch = Arena::thread_local_instance();
+    Arena::Scope scope(scratch);
+    ExprGen gen(scratch);
+    auto value = bst::visit(gen, d->e);
+    if (!gen.error.empty()) {
+        return GeneratedDef{move(key), {}, move(gen.error)};
     }
-    visit(visitor, *e);
-    return visitor.s;
+    return GeneratedDef{move(key),
+                        StrFormat("const Ref& %s()\n"
+                                  "{\n"
+                                  "    static const Ref value = %s;\n"
+                                  "    return value;\n"
+                                  "}\n",
+                                  def_function_name(d->name), value),
+                        {}};
 }
 
-maybe<Expr> apply_print(Ast& ast, const vector<ExprRef>& xs)
+// Generated code of the definitions of the previous run, keyed by their structural_key(). The
+// key includes the name and the code refers to other definitions only by name, so an entry is
+// valid as long as the definition itself is unchanged. The whole key is stored and compared, a
+// hash collision can't return the code of another definition.
+using Cache = unordered_map<string, string>;
+
+// Bump when the generated code or the key format changes.
+const char* const CACHE_HEADER = "c2-cppgen-cache 2\n";
+
+bool read_file(const string& path, string& content)
 {
-    string s;
-    FOR (i, 1, < ~xs) {
-        s += to_string(xs[i]);
+    auto f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
     }
-
-    // todo encode to c string literal.
-    printf("%s", s.c_str());
-    return *ast.voidleaf();
+    content.clear();
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        content.append(buf, n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
 }
 
-maybe<Expr> eval_apply(Ast& ast, const vector<ExprRef>& xs)
+// Format: CACHE_HEADER, then for each entry "<key size> <code size>\n<key><code>".
+Cache read_cache(const string& path)
 {
-    if (xs.empty()) {
-        fprintf(stderr, "ERROR: applying empty vector.\n");
-        return {};
-    }
-    auto pf = get_if<SymLeaf>(xs.front());
-    if (!pf) {
-        fprintf(stderr, "ERROR: apply vector's first element is not a symbol but %s.\n",
-                node_type_name(*xs.front()));
+    Cache cache;
+    string content;
+    if (!read_file(path, content) || content.compare(0, strlen(CACHE_HEADER), CACHE_HEADER) != 0) {
+        return cache;
     }
-    auto& kv = *(pf->sym);
-    auto& sym_name = kv.first;
-    if (sym_name == "print") {
-        return apply_print(ast, xs);
-    } else {
-        fprintf(stderr, "ERROR: Unknown function: %s.\n", sym_name.c_str());
-        return {};
+    const char* p = content.c_str() + strlen(CACHE_HEADER);
+    const char* end = content.c_str() + content.size();
+    while (p < end) {
+        // The key is binary, the size line is parsed up to its newline only.
+        auto eol = (const char*)memchr(p, '\n', end - p);
+        size_t key_size, code_size;
+        if (!eol || sscanf(p, "%zu %zu", &key_size, &code_size) != 2 ||
+            key_size > size_t(end - eol - 1) || code_size > size_t(end - eol - 1) - key_size) {
+            return Cache{};  // Corrupt, start over.
+        }
+        p = eol + 1;
+        cache.emplace(string(p, key_size), string(p + key_size, code_size));
+        p += key_size + code_size;
     }
+    return cache;
 }
 
-enum ApplyChoice
+string format_cache(const vector<GeneratedDef>& results)
 {
-    apply_false,
-    apply_true
-};
+    string s = CACHE_HEADER;
+    for (auto& r : results) {
+        StrAppendFormat(&s, "%d %d\n", r.key.size(), r.code.size());
+        s += r.key;
+        s += r.code;
+    }
+    return s;
+}
 
-maybe<Expr> eval(Ast& ast, ExprRef e)
+// Workers take the next definition from a shared counter. Each result goes to its own index, so
+// the output doesn't depend on scheduling. Definitions found in `cache` are not generated again.
+vector<GeneratedDef> generate_defs(const vector<const bst::Def*>& defs,
+                                   const Cache& cache,
+                                   int n_jobs)
 {
-    struct Visitor
-    {
-        Ast& ast;
-        const ExprRef expr_ref;
-        Visitor(Ast& ast, ExprRef expr_ref) : ast(ast), expr_ref(expr_ref) {}
-        maybe<Expr> operator()(const TupleNode& e, ApplyChoice apply_choice = apply_false)
-        {
-            vector<ExprRef> ys;
-            ys.reserve(~e.xs);
-            for (auto x : e.xs) {
-                maybe<Expr> my = eval(ast, x);
-                if (!my)
-                    return {};
-                if (!holds_alternative<VoidLeaf>(*my)) {
-                    ast.storage.emplace_back(move(*my));
-                    ys.push_back(&ast.storage.back());
-                }
-            }
-            if (apply_choice == apply_true) {
-                return eval_apply(ast, ys);
+    vector<GeneratedDef> results(~defs);
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int i; (i = next++) < ~defs;) {
+            auto key = bst::structural_key(defs[i]);
+            auto it = cache.find(key);
+            if (it != cache.end()) {
+                results[i] = GeneratedDef{move(key), it->second, {}};
             } else {
-                return Expr(in_place_type<TupleNode>, move(ys));
+                TIME_SCOPE("cppgen generate def");
+                results[i] = generate_def(defs[i], move(key));
             }
         }
-        maybe<Expr> operator()(const StrNode& x) { return *expr_ref; }
-        maybe<Expr> operator()(const SymLeaf& x) { return *expr_ref; }
-        maybe<Expr> operator()(const NumLeaf& x) { return *expr_ref; }
-        maybe<Expr> operator()(const CharLeaf& x) { return *expr_ref; }
-        maybe<Expr> operator()(const VoidLeaf& x) { return *expr_ref; }
-        maybe<Expr> operator()(const ApplyNode& x) { return (*this)(*x.tuple_ref, apply_true); }
-        maybe<Expr> operator()(const QuoteNode& x) { return *x.expr_ref; }
     };
-    return visit(Visitor{ast, e}, *e);
+    vector<std::thread> threads;
+    FOR (i, 1, < std::min(n_jobs, ~defs)) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+    return results;
 }
 
-bool cppgen(Ast& ast, const CommandLineOptions& clo)
+// Definitions are assigned to shards by their name, so editing, adding or removing one doesn't
+// move the others and the unchanged shards are not rewritten.
+int shard_of(const string& name, int n_shards)
 {
-    bool ok = true;
+    uint32_t h = 2166136261u;  // FNV-1a.
+    for (unsigned char c : name) {
+        h = (h ^ c) * 16777619u;
+    }
+    return int(h % uint32_t(n_shards));
+}
 
-    for (auto& e : ast.top_level_exprs) {
-        auto r = eval(ast, e);
-        if (r) {
-            dump(&*r);
-        } else {
+// Leaves the file untouched if it has the same content, so the build system doesn't recompile it.
+bool write_file_if_changed(const string& path, const string& content)
+{
+    string old_content;
+    if (read_file(path, old_content) && old_content == content) {
+        return true;
+    }
+    auto f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "Can't open %s for writing.\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), f) == content.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Error writing %s.\n", path.c_str());
+    }
+    return ok;
+}
+
+// Split `path` into the part before the extension and the extension (with the dot).
+pair<string, string> split_extension(const string& path)
+{
+    auto slash = path.find_last_of("/\\");
+    auto dot = path.rfind('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) {
+        return {path, ""};
+    }
+    return {path.substr(0, dot), path.substr(dot)};
+}
+
+}  // namespace
+
+bool cppgen(const vector<const bst::Def*>& defs, const CommandLineOptions& clo)
+{
+    TIME_SCOPE("cppgen");
+    int n_jobs = clo.jobs > 0 ? clo.jobs : std::max(1u, std::thread::hardware_concurrency());
+    auto [stem, extension] = split_extension(clo.cpp_out);
+    auto cache_path = stem + ".cppgen-cache";
+    auto cache = [&]() {
+        TIME_SCOPE("cppgen read cache");
+        return read_cache(cache_path);
+    }();
+    auto results = generate_defs(defs, cache, n_jobs);
+    bool ok = true;
+    FOR (i, 0, < ~defs) {
+        if (!results[i].error.empty()) {
+            fprintf(stderr, "Error: %s\n", results[i].error.c_str());
             ok = false;
         }
     }
-    return ok;
+    if (!ok) {
+        return false;
+    }
+
+    TIME_SCOPE("cppgen write");
+    auto header_path = stem + ".h";
+    auto header_name = header_path.substr(header_path.find_last_of("/\\") + 1);
+
+    string header = HEADER_PRELUDE;
+    header += "// Top-level definitions.\n";
+    bool has_entry_point = false;
+    for (auto d : defs) {
+        StrAppendFormat(&header, "const Ref& %s();\n", def_function_name(d->name));
+        has_entry_point = has_entry_point || d->name == "main";
+    }
+    StrAppendFormat(&header, "\n}  // namespace %s\n", GENERATED_NAMESPACE);
+    ok = write_file_if_changed(header_path, header);
+
+    vector<string> tus(clo.cpp_shards);
+    for (auto& tu : tus) {
+        tu = StrFormat("// Generated by c2, do not edit.\n#include \"%s\"\n\nnamespace %s {\n",
+                       header_name, GENERATED_NAMESPACE);
+    }
+    FOR (i, 0, < ~defs) {
+        tus[shard_of(defs[i]->name, clo.cpp_shards)] += "\n" + results[i].code;
+    }
+    FOR (shard, 0, < clo.cpp_shards) {
+        auto& tu = tus[shard];
+        StrAppendFormat(&tu, "\n}  // namespace %s\n", GENERATED_NAMESPACE);
+        if (shard == 0 && has_entry_point) {
+            // The entry point is called with unit arg.
+            StrAppendFormat(&tu,
+                            "\nint main()\n"
+                            "{\n"
+                            "    %s::apply(%s::%s(), {%s::tuple({})});\n"
+                            "}\n",
+                            GENERATED_NAMESPACE, GENERATED_NAMESPACE, def_function_name("main"),
+                            GENERATED_NAMESPACE);
+        }
+        auto path =
+            clo.cpp_shards == 1 ? clo.cpp_out : StrFormat("%s_%d%s", stem, shard, extension);
+        ok = write_file_if_changed(path, tu) && ok;
+    }
+    // Shards of an earlier run with more of them would be compiled along with the new ones. The
+    // shards are numbered from 0 without gaps, so the search stops at the first missing one.
+    for (int shard = clo.cpp_shards == 1 ? 0 : clo.cpp_shards;
+         remove(StrFormat("%s_%d%s", stem, shard, extension).c_str()) == 0; ++shard) {
+    }
+    return write_file_if_changed(cache_path, format_cache(results)) && ok;
 }
 
 }  // namespace forrest
-#endif
@@ -1,12 +1,14 @@
-#if 0
 #pragma once
 
+#include "bst.h"
+
 namespace forrest {
 
-struct Ast;
 struct CommandLineOptions;
 
-bool cppgen(Ast& ast, const CommandLineOptions& clo);
+// Write C++ code for the top-level definitions into a shared header and `clo.cpp_shards`
+// translation units. The definitions are generated on `clo.jobs` threads, the output doesn't
+// depend on the number of threads.
+bool cppgen(const vector<const bst::Def*>& defs, const CommandLineOptions& clo);
 
 }  // namespace forrest
-#endif
\ No newline at end of file
@@ -9,9 +9,11 @@
 #include "ast_syntax.h"
 #include "bst.h"
 #include "command_line.h"
+#include "compile.h"
 #include "consts.h"
 #include "cppgen.h"
 #include "cst.h"
+#include "server.h"
 #include "ul/check.h"
 #include "ul/string.h"
 #include "ul/usual.h"
@@ -35,26 +37,19 @@ using namespace ul;
 static const char* const USAGE_TEXT =
     R"~~~~(%1$s: parse forrest-AST text file
 Usage: %1$s --help
-       %1$s <input-files> [--cpp-out <filename>]
+       %1$s <input-files> [--check] [--cpp-out <filename> [--cpp-shards <n>] [--jobs <n>]]
+                [--time-report] [--trace-out <filename>] [--connect <socket>]
+       %1$s --server <socket>
+
+--check stops after parsing and binding the names.
+--cpp-shards <n> splits the generated code into <n> translation units next to the
+header, --jobs <n> sets the number of code generation threads.
+--server <socket> runs a compile server which keeps the parsed input files in memory
+and re-parses only the changed ones, --connect <socket> sends the command line to it.
+--time-report prints the time spent in the compiler phases to stderr, --trace-out
+<filename> writes them as Chrome trace-event JSON.
 )~~~~";
 
-// Add parsed data to ast.
-maybe<vector<ast::Expr*>> parse_fast_file_add_to_ast(const string& filename, Ast& ast)
-{
-    auto lr = FileReader::new_(filename);
-    if (is_left(lr)) {
-        report_error(left(lr));
-        return {};
-    }
-    // Call AstBuilder with new FileReader.
-    auto plr = AstBuilder::parse_filereader_into_ast(right(lr), ast);
-    if (is_left(plr)) {
-        report_error(left(plr));
-        return {};
-    }
-    return right(plr);
-}
-
 int run_fc_with_parsed_command_line(const CommandLineOptions& o)
 {
     if (o.files.empty()) {
@@ -63,13 +58,12 @@ int run_fc_with_parsed_command_line(const CommandLineOptions& o)
     }
 
     bool ok = true;
-    Ast ast;
-    vector<ast::Expr*> top_level_exprs;
+    vector<SourceFile> sources;
     for (auto& f : o.files) {
-        auto m_exprs = parse_fast_file_add_to_ast(f, ast);
-        if (m_exprs) {
+        auto m_source = parse_source_file(f);
+        if (m_source) {
             absl::PrintF("Compiled %s\n", f);
-            top_level_exprs.insert(top_level_exprs.end(), BE(*m_exprs));
+            sources.push_back(move(*m_source));
         } else {
             ok = false;
         }
@@ -77,64 +71,11 @@ int run_fc_with_parsed_command_line(const CommandLineOptions& o)
     if (!ok) {
         return EXIT_FAILURE;
     }
-    // Dump top level expressions.
-    FOR (i, 0, < ~top_level_exprs) {
-        PrintF("-- TOP LEVEL #%d\n", i);
-        dump(top_level_exprs[i]);
-    }
-    vector<const bst::Expr*> top_level_bexprs;
-
-    bst::LexicalScope ls_root;
-    for (auto x : top_level_exprs) {
-        top_level_bexprs.push_back(process_ast(x, &ls_root));
+    vector<const SourceFile*> source_ptrs;
+    for (auto& s : sources) {
+        source_ptrs.push_back(&s);
     }
-    /*
-    for (auto x : top_level_bexprs) {
-        dump_dfs(x);
-    }*/
-    // Process top-level expressions.
-    using namespace bst;
-    map<string, pair<const Variable*, const Expr*>> toplevel_variables;
-    using namespace bst;
-    for (auto x : top_level_bexprs) {
-        switch (x->type) {
-            case tDef: {
-                auto d = cast<Def>(x);
-                CHECK(toplevel_variables.count(d->name) == 0);
-                auto v = new bst::Variable(d->name);
-                toplevel_variables[d->name] = make_pair(v, d->e);
-            } break;
-
-            default:
-                UL_UNREACHABLE;
-                break;
-        }
-    }
-
-    const string ENTRY_POINT = "main";
-    auto it = toplevel_variables.find(ENTRY_POINT);
-    CHECK(it != toplevel_variables.end(), "No entry point found");
-    auto var_expr = it->second;
-    PrintF("%s\n", to_string(var_expr.SND->to_stringtree(), false));
-    // Call the entry point function, will be called with unit arg.
-    auto compiled_main_function = compile_function(var_expr.SND, {&bst::EXPR_EMPTY_TUPLE});
-    /*
-        Shell shell;
-        for (auto x : top_level_exprs) {
-            auto lr = shell.eval(x);
-            if (is_left(lr)) {
-                fprintf(stderr, "Error: %s\n", left(lr).msg.c_str());
-                return EXIT_FAILURE;
-            }
-        }
-
-        for (auto& kv : shell.symbols) {
-            auto& s = kv.first;
-            auto& v = kv.second;
-            int a = 3;
-        }
-    */
-    return EXIT_SUCCESS;
+    return compile_source_files(source_ptrs, o);
 }
 
 int c2main(int argc, const char** argv)
@@ -150,8 +91,16 @@ int c2main(int argc, const char** argv)
     if (cl.help) {
         PrintF(USAGE_TEXT, PROGRAM_NAME);
         result = EXIT_SUCCESS;
+    } else if (!cl.server_socket.empty()) {
+        result = run_server(cl.server_socket);
+    } else if (!cl.connect_socket.empty()) {
+        result = run_client(cl.connect_socket, argc, argv);
     } else {
+        begin_timing(cl);
         result = run_fc_with_parsed_command_line(cl);
+        if (!end_timing(cl)) {
+            result = EXIT_FAILURE;
+        }
     }
     return result;
 }
@@ -0,0 +1,448 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FORREST_HAS_UNIX_SOCKETS 1
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define FORREST_HAS_UNIX_SOCKETS 0
+#endif
+
+#include "absl/strings/str_format.h"
+#include "ul/usual.h"
+
+#include "command_line.h"
+#include "compile.h"
+
+namespace forrest {
+
+using absl::PrintF;
+using absl::StrAppendFormat;
+using absl::StrFormat;
+using std::unordered_map;
+using std::vector;
+
+using namespace ul;
+
+#if FORREST_HAS_UNIX_SOCKETS
+
+namespace {
+
+// Request: the working directory and the arguments, each terminated by '\0', then the client
+// shuts down its side. Response: "<exit code>\n" followed by the output until the end of stream.
+
+bool write_all(int fd, const char* p, size_t n)
+{
+    while (n > 0) {
+        auto written = write(fd, p, n);
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        n -= size_t(written);
+    }
+    return true;
+}
+
+string read_all(int fd)
+{
+    string s;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        s.append(buf, size_t(n));
+    }
+    return s;
+}
+
+maybe<sockaddr_un> socket_address(const string& socket_path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path.c_str());
+        return {};
+    }
+    memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    return addr;
+}
+
+struct FileStamp
+{
+    int64_t mtime_ns = 0;
+    int64_t size = -1;
+
+    bool operator==(const FileStamp& y) const { return mtime_ns == y.mtime_ns && size == y.size; }
+};
+
+maybe<FileStamp> stamp_of(const string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return {};
+    }
+#if defined(__APPLE__)
+    auto& mtime = st.st_mtimespec;
+#else
+    auto& mtime = st.st_mtim;
+#endif
+    return FileStamp{int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec, int64_t(st.st_size)};
+}
+
+struct CachedFile
+{
+    FileStamp stamp;
+    SourceFile source;
+};
+
+// An input file which changed since it was cached. It's read before the request is forked, so the
+// request and the cache update parse the same content.
+struct ChangedFile
+{
+    FileStamp stamp;
+    string content;
+};
+
+class Server
+{
+public:
+    // Runs a request with its stdout and stderr going to `output`.
+    int handle(const string& cwd, const vector<string>& args, string& output);
+    // Parses the input files which changed for the last request into the cache, if the request
+    // succeeded. Called after the response was sent, the client doesn't wait for it.
+    void update_files();
+
+private:
+    unordered_map<string, CachedFile> files;           // By absolute path.
+    unordered_map<string, ChangedFile> changed_files;  // Of the last request, by absolute path.
+    unordered_map<string, SourceFile> parsed_files;    // In the child, the changed files parsed.
+    bool request_succeeded = false;
+    string cwd_of_request;
+
+    int run_request(const CommandLineOptions& o);
+    int run(const CommandLineOptions& o);
+    void read_changed_files(const CommandLineOptions& o);
+    string absolute_path(const string& path) const;
+    // Returns the cached file or parses the changed one. Sets `parsed` if it was parsed now.
+    const SourceFile* get_file(const string& path, bool& parsed);
+};
+
+string Server::absolute_path(const string& path) const
+{
+    return path.empty() || path[0] == '/' ? path : StrFormat("%s/%s", cwd_of_request, path);
+}
+
+void Server::read_changed_files(const CommandLineOptions& o)
+{
+    for (auto& f : o.files) {
+        auto path = absolute_path(f);
+        // The stamp is taken first, a change while reading makes the next request read it again.
+        auto m_stamp = stamp_of(path);
+        auto it = files.find(path);
+        if (m_stamp && it != files.end() && it->second.stamp == *m_stamp) {
+            continue;
+        }
+        int fd = m_stamp ? open(path.c_str(), O_RDONLY) : -1;
+        if (fd < 0) {
+            // Unreadable, get_file() reports it.
+            if (it != files.end()) {
+                files.erase(it);
+            }
+            continue;
+        }
+        changed_files[path] = ChangedFile{*m_stamp, read_all(fd)};
+        close(fd);
+    }
+}
+
+const SourceFile* Server::get_file(const string& path, bool& parsed)
+{
+    parsed = false;
+    auto it = changed_files.find(path);
+    if (it == changed_files.end()) {
+        auto cached = files.find(path);
+        if (cached != files.end()) {
+            return &cached->second.source;
+        }
+    }
+    // A file which couldn't be read before the fork is parsed from disk for the error message.
+    auto m_source = it != changed_files.end() ? parse_source_file(path, it->second.content)
+                                              : parse_source_file(path);
+    if (!m_source) {
+        return nullptr;
+    }
+    parsed = true;
+    return &parsed_files.insert_or_assign(path, move(*m_source)).first->second;
+}
+
+int Server::run(const CommandLineOptions& o)
+{
+    if (o.help || !o.server_socket.empty() || !o.connect_socket.empty()) {
+        fprintf(stderr, "Invalid request.\n");
+        return EXIT_FAILURE;
+    }
+    if (o.files.empty()) {
+        fprintf(stderr, "No input files.\n");
+        return EXIT_FAILURE;
+    }
+    vector<const SourceFile*> sources;
+    bool ok = true;
+    for (auto& f : o.files) {
+        auto path = absolute_path(f);
+        bool parsed;
+        auto sf = get_file(path, parsed);
+        if (parsed) {
+            PrintF("Compiled %s\n", path);
+        }
+        if (sf) {
+            sources.push_back(sf);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return EXIT_FAILURE;
+    }
+    return compile_source_files(sources, o);
+}
+
+// Runs the request in the child process.
+int Server::run_request(const CommandLineOptions& o)
+{
+    int result = EXIT_FAILURE;
+    try {
+        // The trace is written by the server, relative to the client's working directory.
+        begin_timing(o);
+        result = run(o);
+        if (!end_timing(o)) {
+            result = EXIT_FAILURE;
+        }
+    } catch (std::exception& e) {
+        fprintf(stderr, "Aborting, exception: %s\n", e.what());
+    } catch (...) {
+        fprintf(stderr, "Aborting, unknown exception\n");
+    }
+    return result;
+}
+
+void Server::update_files()
+{
+    if (request_succeeded) {
+        for (auto& [path, cf] : changed_files) {
+            // The child parsed the same content without failing a CHECK. Replacing the entry frees
+            // the AST and the bst of the previous version.
+            auto m_source = parse_source_file(path, cf.content);
+            if (m_source) {
+                files.insert_or_assign(path, CachedFile{cf.stamp, move(*m_source)});
+            } else {
+                files.erase(path);
+            }
+        }
+    }
+    changed_files.clear();
+    request_succeeded = false;
+}
+
+int Server::handle(const string& cwd, const vector<string>& args, string& output)
+{
+    changed_files.clear();
+    request_succeeded = false;
+    // Generated files are written relative to the client's working directory.
+    if (chdir(cwd.c_str()) != 0) {
+        output = StrFormat("Can't change to directory %s.\n", cwd);
+        return EXIT_FAILURE;
+    }
+    cwd_of_request = cwd;
+
+    auto f = tmpfile();
+    if (!f) {
+        output = "Can't create temporary file for the output.\n";
+        return EXIT_FAILURE;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    // The command line is parsed here for the input files to read before the fork, its errors go
+    // to the output.
+    vector<const char*> argv{"c2"};
+    for (auto& a : args) {
+        argv.push_back(a.c_str());
+    }
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(fileno(f), STDERR_FILENO);
+    auto m_cl = parse_command_line(~argv, argv.data());
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    if (!m_cl) {
+        rewind(f);
+        output = read_all(fileno(f));
+        fclose(f);
+        return EXIT_FAILURE;
+    }
+    read_changed_files(*m_cl);
+    // The request runs in a child process with a copy of the cache, a failed CHECK or
+    // UL_UNREACHABLE in the front end aborts the request and not the server. The timing events of
+    // the request go away with the child.
+    auto pid = fork();
+    if (pid == 0) {
+        dup2(fileno(f), STDOUT_FILENO);
+        dup2(fileno(f), STDERR_FILENO);
+        int result = run_request(*m_cl);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(result);
+    }
+    if (pid < 0) {
+        output = StrFormat("Can't fork: %s\n", strerror(errno));
+        fclose(f);
+        return EXIT_FAILURE;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            status = -1;
+            break;
+        }
+    }
+    rewind(f);
+    output = read_all(fileno(f));
+    fclose(f);
+
+    if (status == -1 || !WIFEXITED(status)) {
+        StrAppendFormat(&output, "The compiler died (%s).\n",
+                        status != -1 && WIFSIGNALED(status) ? strsignal(WTERMSIG(status))
+                                                            : "unknown status");
+        return EXIT_FAILURE;
+    }
+    int result = WEXITSTATUS(status);
+    request_succeeded = result == EXIT_SUCCESS;
+    return result;
+}
+
+}  // namespace
+
+int run_server(const string& socket_path)
+{
+    auto m_addr = socket_address(socket_path);
+    if (!m_addr) {
+        return EXIT_FAILURE;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+    unlink(socket_path.c_str());  // Left over from a previous server.
+    if (bind(listener, reinterpret_cast<sockaddr*>(&*m_addr), sizeof(*m_addr)) != 0 ||
+        listen(listener, 16) != 0) {
+        perror(socket_path.c_str());
+        close(listener);
+        return EXIT_FAILURE;
+    }
+    PrintF("Listening on %s\n", socket_path);
+    fflush(stdout);
+    // A client which went away before reading the response must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    Server server;
+    for (;;) {
+        int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0) {
+            perror("accept");
+            continue;
+        }
+        auto request = read_all(conn);
+        vector<string> strings;
+        for (size_t b = 0, e; (e = request.find('\0', b)) != string::npos; b = e + 1) {
+            strings.emplace_back(request, b, e - b);
+        }
+        string output;
+        int result;
+        if (strings.empty()) {
+            output = "Invalid request.\n";
+            result = EXIT_FAILURE;
+        } else {
+            auto cwd = move(strings.front());
+            strings.erase(strings.begin());
+            result = server.handle(cwd, strings, output);
+        }
+        auto response = StrFormat("%d\n", result) + output;
+        if (!write_all(conn, response.data(), response.size())) {
+            perror("Sending the response");
+        }
+        close(conn);
+        server.update_files();
+    }
+}
+
+int run_client(const string& socket_path, int argc, const char** argv)
+{
+    auto m_addr = socket_address(socket_path);
+    if (!m_addr) {
+        return EXIT_FAILURE;
+    }
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd");
+        return EXIT_FAILURE;
+    }
+    string request(cwd, strlen(cwd) + 1);
+    FOR (i, 1, < argc) {
+        if (strcmp(argv[i], "--connect") == 0) {
+            ++i;
+            continue;
+        }
+        request.append(argv[i], strlen(argv[i]) + 1);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&*m_addr), sizeof(*m_addr)) != 0) {
+        perror(socket_path.c_str());
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+    bool ok = write_all(fd, request.data(), request.size());
+    shutdown(fd, SHUT_WR);
+    auto response = ok ? read_all(fd) : string();
+    close(fd);
+
+    auto newline = response.find('\n');
+    if (newline == string::npos) {
+        fprintf(stderr, "No response from %s.\n", socket_path.c_str());
+        return EXIT_FAILURE;
+    }
+    fwrite(response.data() + newline + 1, 1, response.size() - newline - 1, stdout);
+    return atoi(response.c_str());
+}
+
+#else
+
+int run_server(const string& socket_path)
+{
+    fprintf(stderr, "The compile server needs Unix-domain sockets.\n");
+    return EXIT_FAILURE;
+}
+
+int run_client(const string& socket_path, int argc, const char** argv)
+{
+    fprintf(stderr, "The compile server needs Unix-domain sockets.\n");
+    return EXIT_FAILURE;
+}
+
+#endif
+
+}  // namespace forrest
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace forrest {
+
+using std::string;
+
+// Compile server listening on a Unix-domain socket. It keeps the parsed and bound top-level
+// expressions of the input files between requests, a request re-parses only the files which
+// changed since they were last parsed. Requests are handled one at a time, each in a forked child
+// process, so a failed CHECK in the compiler fails only the request.
+int run_server(const string& socket_path);
+
+// Forwards the command line (without `--connect <socket>`) and the working directory to the
+// server, prints the output of the request and returns its exit code.
+int run_client(const string& socket_path, int argc, const char** argv);
+
+}  // namespace forrest
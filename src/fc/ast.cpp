@@ -77,6 +77,11 @@ void dump(Node* expr_ptr)
             quotes += '`';
             visit(*this, x->expr->thisv());
         }
+        void operator()(const ClosureNode* x)
+        {
+            PrintF("%s%sCLOSURE, %d bound args\n", ind, quotes, x->n_bound_args);
+            quotes.clear();
+        }
     };
 
     visit(Visitor{}, expr_ptr->thisv());
@@ -24,6 +24,7 @@ struct StrNode;
 struct TupleNode;
 struct ApplyNode;
 struct QuoteNode;
+struct ClosureNode;
 namespace tag {
 struct Char
 {
@@ -53,11 +54,29 @@ struct Quote
 {
     using Ptr = QuoteNode*;
 };
+struct Closure
+{
+    using Ptr = ClosureNode*;
+};
 };  // namespace tag
 
-using Tag = variant<tag::Char, tag::Num, tag::Sym, tag::Str, tag::Tuple, tag::Apply, tag::Quote>;
-
-using NodePV = variant<CharLeaf*, NumLeaf*, SymLeaf*, StrNode*, TupleNode*, ApplyNode*, QuoteNode*>;
+using Tag = variant<tag::Char,
+                    tag::Num,
+                    tag::Sym,
+                    tag::Str,
+                    tag::Tuple,
+                    tag::Apply,
+                    tag::Quote,
+                    tag::Closure>;
+
+using NodePV = variant<CharLeaf*,
+                       NumLeaf*,
+                       SymLeaf*,
+                       StrNode*,
+                       TupleNode*,
+                       ApplyNode*,
+                       QuoteNode*,
+                       ClosureNode*>;
 
 struct Node
 {
@@ -81,7 +100,9 @@ struct StrNode : Node
 
 struct SymLeaf : Node
 {
+    static const int NO_SLOT = -1;
     const string name;
+    int slot = NO_SLOT;  // Index into Shell::globals, assigned when compiled or first looked up.
     explicit SymLeaf(string name) : Node(tag::Sym{}), name(move(name)) {}
     NodePV thisv() override { return this; }
 };
@@ -125,6 +146,25 @@ struct QuoteNode : Node
     NodePV thisv() override { return this; }
 };
 
+struct FnCode;
+struct Frame;
+
+// Value of an evaluated `fn` form, never produced by the parser.
+struct ClosureNode : Node
+{
+    const FnCode* const fn;
+    const Frame* const env;  // Captured lexical environment.
+    // Arguments of the partial applications so far. Allocated with the closure in the same arena,
+    // a vector would never be destructed there.
+    Node* const* const bound_args;
+    const int n_bound_args;
+    ClosureNode(const FnCode* fn, const Frame* env, Node* const* bound_args, int n_bound_args)
+        : Node(tag::Closure{}), fn(fn), env(env), bound_args(bound_args), n_bound_args(n_bound_args)
+    {}
+    ClosureNode(const FnCode* fn, const Frame* env) : ClosureNode(fn, env, nullptr, 0) {}
+    NodePV thisv() override { return this; }
+};
+
 void dump(Node* expr);
 
 }  // namespace forrest
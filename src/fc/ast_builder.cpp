@@ -4,13 +4,12 @@
 
 #include "absl/strings/str_format.h"
 #include "ul/usual.h"
-#include "util/arena.h"
 #include "util/filereader.h"
 
-#include "ast.h"
 #include "ast_syntax.h"
 #include "command_line.h"
 #include "errors.h"
+#include "flat_ast.h"
 
 namespace forrest {
 
@@ -26,7 +25,7 @@ using absl::StrFormat;
 class AstBuilderImpl
 {
     FileReader& fr;
-    Arena& storage;
+    FlatAst& ast;
 
     string error;
 
@@ -37,11 +36,11 @@ class AstBuilderImpl
     };
 
 public:
-    AstBuilderImpl(FileReader& fr, Arena& storage) : fr(fr), storage(storage) {}
+    AstBuilderImpl(FileReader& fr, FlatAst& ast) : fr(fr), ast(ast) {}
 
-    maybe<vector<Node*>> run()
+    maybe<vector<FlatRef>> run()
     {
-        vector<Node*> top_level_exprs;
+        vector<FlatRef> top_level_exprs;
         for (;;) {
             fr.skip_whitespace();
             if (fr.n_unread_chars() == 0) {
@@ -60,7 +59,7 @@ public:
 
 private:
     // Whitespace skipped before this.
-    maybe<Node*> read_expr()
+    maybe<FlatRef> read_expr()
     {
         if (!fr.read_ahead_at_least_1()) {
             report_error();
@@ -87,7 +86,7 @@ private:
                 report_error("Invalid UTF8 character literal at");
                 return {};
             }
-            return storage.new_<CharLeaf>(*mcp);
+            return ast.add_char(*mcp);
         } else if (fr.peek_wora(
                        [](Utf8Char c) { return c == '-' || c == '+' || isdigit(c.front()); })) {
             return read_num();
@@ -99,7 +98,7 @@ private:
         UL_UNREACHABLE;
     }
 
-    maybe<ApplyNode*> read_apply()
+    maybe<FlatRef> read_apply()
     {
         auto mx = read_tuple_to_vector(OPEN_APPLY_CHAR, CLOSE_APPLY_CHAR);
         if (!mx)
@@ -109,29 +108,29 @@ private:
             fprintf(stderr, "Empty {}.\n");
             return {};
         }
-        auto tn = storage.new_<TupleNode>(xs.begin() + 1, xs.end());
-        return storage.new_<ApplyNode>(xs.front(), tn);
+        return ast.add_apply(xs.front(), xs.data() + 1, xs.data() + xs.size());
     };
 
-    maybe<QuoteNode*> read_quote()
+    maybe<FlatRef> read_quote()
     {
-        maybe<Node*> mx = read_expr();
+        maybe<FlatRef> mx = read_expr();
         if (!mx)
             return {};
-        return storage.new_<QuoteNode>(*mx);
+        return ast.add_quote(*mx);
     }
 
-    maybe<TupleNode*> read_tuple(char open_char, char close_char)
+    maybe<FlatRef> read_tuple(char open_char, char close_char)
     {
         auto mt = read_tuple_to_vector(open_char, close_char);
         if (!mt)
             return {};
-        return storage.new_<TupleNode>(BE(*mt));
+        return ast.add_tuple(mt->data(), mt->data() + mt->size());
     }
-    maybe<vector<Node*>> read_tuple_to_vector(char open_char, char close_char)
+    // Children are added to the FlatAst before their parent, so the parent's range is contiguous.
+    maybe<vector<FlatRef>> read_tuple_to_vector(char open_char, char close_char)
     {
         CharLC open_char_lc{open_char, fr.line(), fr.col()};
-        vector<Node*> xs;
+        vector<FlatRef> xs;
         for (;;) {
             fr.skip_whitespace();
             if (!fr.read_ahead_at_least_1()) {
@@ -144,6 +143,11 @@ private:
             auto mx = read_expr();
             if (!mx)
                 return {};
+            // The item may have ended at the end of the read buffer.
+            if (!fr.read_ahead_at_least_1()) {
+                report_missing_char(close_char, open_char_lc);
+                return {};
+            }
             // An item must be followed by whitespace or closing char.
             if (!fr.peek_wora(
                     [close_char](Utf8Char c) { return c == close_char || isspace(c.front()); })) {
@@ -196,7 +200,7 @@ private:
         return nc;
     }
 
-    maybe<StrNode*> read_str()
+    maybe<FlatRef> read_str()
     {
         CharLC begin_char{STRING_QUOTE_CHAR, fr.line(), fr.col()};
         string xs;
@@ -209,13 +213,13 @@ private:
                 return {};
             }
             if (*m_nc == STRING_QUOTE_CHAR) {
-                return storage.new_<StrNode>(move(xs));
+                return ast.add_str(xs);
             }
             xs.append(BE(*m_nc));
         }
     }
 
-    maybe<NumLeaf*> read_num()
+    maybe<FlatRef> read_num()
     {
         enum State
         {
@@ -304,10 +308,10 @@ private:
                     UL_UNREACHABLE;
             }  // switch state
         } while (state != DONE);
-        return storage.new_<NumLeaf>(move(xs));
+        return ast.add_num(xs);
     }
 
-    maybe<SymLeaf*> read_sym()
+    maybe<FlatRef> read_sym()
     {
         string xs;
         for (;;) {
@@ -321,7 +325,7 @@ private:
             report_error();
             return {};
         }
-        return storage.new_<SymLeaf>(move(xs));
+        return ast.add_sym(xs);
     }
 
     void report_error(const string& msg)
@@ -334,8 +338,8 @@ private:
         if (m_nc) {
             report_error(StrFormat("Unexpected char %s in file", to_descriptive_string(*m_nc)));
         } else {
-            if (fr.is_error()) {
-                error = fr.get_error();
+            if (auto me = fr.maybe_get_error()) {
+                error = *me;
             } else if (fr.is_eof()) {
                 report_error("Unexpected end of file at");
             } else {
@@ -352,9 +356,9 @@ private:
 };
 
 namespace AstBuilder {
-maybe<vector<Node*>> parse_filereader_into_ast(FileReader& fr, Arena& storage)
+maybe<vector<FlatRef>> parse_filereader_into_ast(FileReader& fr, FlatAst& ast)
 {
-    return AstBuilderImpl{fr, storage}.run();
+    return AstBuilderImpl{fr, ast}.run();
 }
 }  // namespace AstBuilder
 
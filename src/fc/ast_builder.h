@@ -4,7 +4,7 @@
 
 #include "util/maybe.h"
 
-#include "ast.h"
+#include "flat_ast.h"
 
 namespace forrest {
 
@@ -13,10 +13,8 @@ class FileReader;
 using std::unique_ptr;
 using std::vector;
 
-class Arena;
-
 namespace AstBuilder {
-maybe<vector<Node*>> parse_filereader_into_ast(FileReader& fr, Arena& storage);
+maybe<vector<FlatRef>> parse_filereader_into_ast(FileReader& fr, FlatAst& ast);
 }
 
 }  // namespace forrest
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #include "ul/maybe.h"
 #include "ul/usual.h"
@@ -14,8 +16,53 @@ namespace forrest {
 
 using std::array;
 using std::string;
+using std::string_view;
 using std::unique_ptr;
-using std::unordered_map;
+
+// Must correspond to BuiltinNames::NameId.
+constexpr array<string_view, 2> BUILTIN_NAMES = {"fn", "def"};
+
+// Perfect hash of BUILTIN_NAMES, the seed and the table are computed at compile time.
+namespace builtin_names_hash {
+constexpr uint32_t hash(string_view s, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (auto c : s) {
+        h = (h ^ uint8_t(c)) * 16777619u;
+    }
+    return h;
+}
+constexpr size_t TABLE_SIZE = 2 * BUILTIN_NAMES.size();
+constexpr uint32_t find_seed()
+{
+    for (uint32_t seed = 0;; ++seed) {
+        array<bool, TABLE_SIZE> used{};
+        bool ok = true;
+        for (auto n : BUILTIN_NAMES) {
+            auto i = hash(n, seed) % TABLE_SIZE;
+            ok = ok && !used[i];
+            used[i] = true;
+        }
+        if (ok) {
+            return seed;
+        }
+    }
+}
+constexpr uint32_t SEED = find_seed();
+// Index into BUILTIN_NAMES or -1.
+constexpr array<int8_t, TABLE_SIZE> make_table()
+{
+    array<int8_t, TABLE_SIZE> table{};
+    for (auto& x : table) {
+        x = -1;
+    }
+    for (size_t i = 0; i < BUILTIN_NAMES.size(); ++i) {
+        table[hash(BUILTIN_NAMES[i], SEED) % TABLE_SIZE] = int8_t(i);
+    }
+    return table;
+}
+constexpr array<int8_t, TABLE_SIZE> TABLE = make_table();
+}  // namespace builtin_names_hash
 
 class BuiltinNames
 {
@@ -29,7 +76,6 @@ public:
 
 private:
     array<SymLeaf*, COUNT> symbols;
-    unordered_map<string, NameId> cstring_to_names;
 
     BuiltinNames();
 
@@ -37,8 +83,32 @@ public:
     static void init_g();
     static unique_ptr<BuiltinNames> g;
 
-    maybe<NameId> string_to_id(const string& s) const;
+    // Returns COUNT if `s` is not a builtin name.
+    static constexpr NameId constexpr_string_to_id(string_view s)
+    {
+        using namespace builtin_names_hash;
+        auto i = TABLE[hash(s, SEED) % TABLE_SIZE];
+        return i >= 0 && BUILTIN_NAMES[i] == s ? NameId(i) : COUNT;
+    }
+    static maybe<NameId> string_to_id(string_view s)
+    {
+        auto id = constexpr_string_to_id(s);
+        if (id == COUNT)
+            return {};
+        return id;
+    }
     SymLeaf* id_to_symleaf(NameId name) const;
+    // The AstBuilder puts these canonical SymLeafs in place of builtin names, so checking for a
+    // builtin doesn't need a string comparison.
+    bool is_builtin(const SymLeaf* p) const
+    {
+        return std::find(BE(symbols), p) != symbols.end();
+    }
 };
 
+static_assert(BUILTIN_NAMES.size() == BuiltinNames::COUNT);
+static_assert(BuiltinNames::constexpr_string_to_id("fn") == BuiltinNames::FN);
+static_assert(BuiltinNames::constexpr_string_to_id("def") == BuiltinNames::DEF);
+static_assert(BuiltinNames::constexpr_string_to_id("main") == BuiltinNames::COUNT);
+
 }  // namespace forrest
@@ -7,6 +7,21 @@ namespace forrest {
 
 using namespace ul;
 
+namespace {
+
+// Reads the path after the option at argv[i] into `path`, advances `i` to it.
+bool parse_path(int argc, const char* argv[], int& i, string& path)
+{
+    if (++i == argc) {
+        fprintf(stderr, "Missing path for %s", argv[i - 1]);
+        return false;
+    }
+    path = argv[i];
+    return true;
+}
+
+}  // namespace
+
 maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[])
 {
     CommandLineOptions cl;
@@ -16,12 +31,15 @@ maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[])
             a += 2;
             if (startswith(a, "help")) {
                 cl.help = true;
+            } else if (startswith(a, "time-report")) {
+                cl.time_report = true;
             } else if (startswith(a, "cpp-out")) {
-                if (++i == argc) {
-                    fprintf(stderr, "Missing path for --cpp-out");
+                if (!parse_path(argc, argv, i, cl.cpp_out)) {
+                    return {};
+                }
+            } else if (startswith(a, "trace-out")) {
+                if (!parse_path(argc, argv, i, cl.trace_out)) {
                     return {};
-                } else {
-                    cl.cpp_out = argv[i];
                 }
             } else {
                 fprintf(stderr, "invalid option: '%s'", argv[i]);
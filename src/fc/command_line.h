@@ -15,6 +15,8 @@ struct CommandLineOptions
     bool help = false;
     vector<string> files;
     string cpp_out;
+    bool time_report = false;  // Print the time spent in the phases to stderr.
+    string trace_out;          // Write a Chrome trace of the phases to this path.
 };
 
 maybe<CommandLineOptions> parse_command_line(int argc, const char* argv[]);
@@ -0,0 +1,227 @@
+#include "flat_ast.h"
+
+#include "absl/strings/str_format.h"
+#include "ul/usual.h"
+#include "util/arena.h"
+#include "util/utf.h"
+
+#include "builtinnames.h"
+
+namespace forrest {
+
+using absl::PrintF;
+using absl::StrFormat;
+
+using namespace ul;
+
+StringId StringInterner::intern(string_view s)
+{
+    auto it = ids.find(s);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    auto id = StringId(strings.size());
+    strings.emplace_back(s);
+    ids.emplace(string_view(strings.back()), id);
+    return id;
+}
+
+StringId StringInterner::add(string_view s)
+{
+    auto id = StringId(strings.size());
+    strings.emplace_back(s);
+    return id;
+}
+
+size_t StringInterner::bytes() const
+{
+    size_t n = ids.size() * (sizeof(string_view) + sizeof(StringId) + sizeof(void*));
+    for (auto& s : strings) {
+        n += sizeof(string) + (s.size() < sizeof(string) ? 0 : s.capacity());
+    }
+    return n;
+}
+
+FlatRef FlatAst::add_char(char32_t c)
+{
+    chars.push_back(c);
+    return FlatRef(NodeKind::Char, chars.size() - 1);
+}
+
+FlatRef FlatAst::add_num(string_view x)
+{
+    nums.push_back(strings.add(x));
+    return FlatRef(NodeKind::Num, nums.size() - 1);
+}
+
+FlatRef FlatAst::add_sym(string_view name)
+{
+    syms.push_back(strings.intern(name));
+    return FlatRef(NodeKind::Sym, syms.size() - 1);
+}
+
+FlatRef FlatAst::add_str(string_view xs)
+{
+    strs.push_back(strings.add(xs));
+    return FlatRef(NodeKind::Str, strs.size() - 1);
+}
+
+FlatRef FlatAst::add_tuple(const FlatRef* first, const FlatRef* last)
+{
+    Range r{uint32_t(children.size()), uint32_t(last - first)};
+    children.insert(children.end(), first, last);
+    tuples.push_back(r);
+    return FlatRef(NodeKind::Tuple, tuples.size() - 1);
+}
+
+FlatRef FlatAst::add_apply(FlatRef lambda, const FlatRef* first_arg, const FlatRef* last_arg)
+{
+    Range r{uint32_t(children.size()), uint32_t(last_arg - first_arg)};
+    children.insert(children.end(), first_arg, last_arg);
+    applies.push_back(Apply{lambda, r});
+    return FlatRef(NodeKind::Apply, applies.size() - 1);
+}
+
+FlatRef FlatAst::add_quote(FlatRef expr)
+{
+    quotes.push_back(expr);
+    return FlatRef(NodeKind::Quote, quotes.size() - 1);
+}
+
+const string& FlatAst::string_of(FlatRef r) const
+{
+    switch (r.kind()) {
+        case NodeKind::Num:
+            return strings[nums[r.index()]];
+        case NodeKind::Sym:
+            return strings[syms[r.index()]];
+        case NodeKind::Str:
+            return strings[strs[r.index()]];
+        default:
+            UL_UNREACHABLE;
+    }
+}
+
+Node* FlatAst::export_(FlatRef r, Arena& storage) const
+{
+    auto export_range = [this, &storage](Range range) {
+        vector<Node*> xs;
+        xs.reserve(range.size);
+        for (auto p = begin(range); p != end(range); ++p) {
+            xs.push_back(export_(*p, storage));
+        }
+        return xs;
+    };
+    auto i = r.index();
+    switch (r.kind()) {
+        case NodeKind::Char:
+            return storage.new_<CharLeaf>(chars[i]);
+        case NodeKind::Num:
+            return storage.new_<NumLeaf>(strings[nums[i]]);
+        case NodeKind::Sym:
+            if (auto m_id = BuiltinNames::string_to_id(strings[syms[i]])) {
+                return BuiltinNames::g->id_to_symleaf(*m_id);
+            }
+            return storage.new_<SymLeaf>(strings[syms[i]]);
+        case NodeKind::Str:
+            return storage.new_<StrNode>(strings[strs[i]]);
+        case NodeKind::Tuple: {
+            auto xs = export_range(tuples[i]);
+            return storage.new_<TupleNode>(BE(xs));
+        }
+        case NodeKind::Apply: {
+            auto lambda = export_(applies[i].lambda, storage);
+            auto xs = export_range(applies[i].args);
+            return storage.new_<ApplyNode>(lambda, storage.new_<TupleNode>(BE(xs)));
+        }
+        case NodeKind::Quote:
+            return storage.new_<QuoteNode>(export_(quotes[i], storage));
+    }
+    UL_UNREACHABLE;
+}
+
+size_t FlatAst::n_nodes() const
+{
+    return chars.size() + nums.size() + syms.size() + strs.size() + tuples.size() +
+           applies.size() + quotes.size();
+}
+
+size_t FlatAst::bytes() const
+{
+    return chars.capacity() * sizeof(char32_t) + nums.capacity() * sizeof(StringId) +
+           syms.capacity() * sizeof(StringId) + strs.capacity() * sizeof(StringId) +
+           tuples.capacity() * sizeof(Range) + applies.capacity() * sizeof(Apply) +
+           quotes.capacity() * sizeof(FlatRef) + children.capacity() * sizeof(FlatRef) +
+           strings.bytes();
+}
+
+void dump(const FlatAst& ast, FlatRef r)
+{
+    struct Dumper
+    {
+        const FlatAst& ast;
+        string ind;
+        string quotes = "";
+        void indent() { ind += " "; }
+        void dedent() { ind.pop_back(); }
+        void dump_range(FlatAst::Range range)
+        {
+            for (auto p = ast.begin(range); p != ast.end(range); ++p) {
+                dump(*p);
+            }
+        }
+        void dump(FlatRef r)
+        {
+            auto i = r.index();
+            switch (r.kind()) {
+                case NodeKind::Tuple:
+                    PrintF("%s%sTUPLE\n", ind, quotes);
+                    quotes.clear();
+                    indent();
+                    dump_range(ast.tuples[i]);
+                    dedent();
+                    break;
+                case NodeKind::Apply:
+                    PrintF("%s%sAPPLY-TUPLE\n", ind, quotes);
+                    quotes.clear();
+                    indent();
+                    dump(ast.applies[i].lambda);
+                    dump_range(ast.applies[i].args);
+                    dedent();
+                    break;
+                case NodeKind::Str: {
+                    string s;
+                    for (auto c : ast.string_of(r)) {
+                        if (!iscntrl(c) && is_ascii_utf8_byte(c))
+                            s += c;
+                        else {
+                            s += StrFormat("\\U+%02X;", c);
+                        }
+                    }
+                    PrintF("%s%sSTR: \"%s\"\n", ind, quotes, s);
+                    quotes.clear();
+                } break;
+                case NodeKind::Sym:
+                    PrintF("%s%sSYM: <%s>\n", ind, quotes, ast.string_of(r));
+                    quotes.clear();
+                    break;
+                case NodeKind::Num:
+                    PrintF("%s%sNUM: %s\n", ind, quotes, ast.string_of(r));
+                    quotes.clear();
+                    break;
+                case NodeKind::Char:
+                    PrintF("%s%sCHR: %s\n", ind, quotes,
+                           utf32_to_descriptive_string(ast.chars[i]));
+                    quotes.clear();
+                    break;
+                case NodeKind::Quote:
+                    quotes += '`';
+                    dump(ast.quotes[i]);
+                    break;
+            }
+        }
+    };
+    Dumper{ast, ""}.dump(r);
+}
+
+}  // namespace forrest
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+namespace forrest {
+
+class Arena;
+
+using std::string_view;
+
+// The fc AST as built by the AstBuilder. Nodes live in per-kind arrays and refer to each other with
+// 32-bit FlatRefs, children of tuples and applies are contiguous ranges in a shared buffer and all
+// strings are kept in a StringInterner, symbols interned. There's no per-node allocation and no
+// virtual dispatch.
+
+enum class NodeKind : uint8_t
+{
+    Char,
+    Num,
+    Sym,
+    Str,
+    Tuple,
+    Apply,
+    Quote
+};
+
+// Kind in the top 3 bits, index into the kind's array in the rest.
+struct FlatRef
+{
+    static const int KIND_SHIFT = 29;
+    static const uint32_t INDEX_MASK = (uint32_t(1) << KIND_SHIFT) - 1;
+
+    uint32_t x;
+
+    FlatRef(NodeKind kind, uint32_t index) : x((uint32_t(kind) << KIND_SHIFT) | index)
+    {
+        assert(index <= INDEX_MASK);
+    }
+    NodeKind kind() const { return NodeKind(x >> KIND_SHIFT); }
+    uint32_t index() const { return x & INDEX_MASK; }
+    bool operator==(FlatRef y) const { return x == y.x; }
+    bool operator!=(FlatRef y) const { return x != y.x; }
+};
+
+static_assert(sizeof(FlatRef) == 4);
+
+using StringId = uint32_t;
+
+class StringInterner
+{
+    std::deque<string> strings;  // Deque so the views in `ids` stay valid.
+    std::unordered_map<string_view, StringId> ids;
+
+public:
+    StringId intern(string_view s);
+    // A new id without looking for an equal string, for literals which rarely repeat.
+    StringId add(string_view s);
+    const string& operator[](StringId id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+    size_t bytes() const;
+};
+
+class FlatAst
+{
+public:
+    struct Range
+    {
+        uint32_t begin, size;
+    };
+    struct Apply
+    {
+        FlatRef lambda;
+        Range args;
+    };
+
+    // Per-kind node arrays, indexed by FlatRef::index().
+    vector<char32_t> chars;
+    vector<StringId> nums;
+    vector<StringId> syms;
+    vector<StringId> strs;
+    vector<Range> tuples;
+    vector<Apply> applies;
+    vector<FlatRef> quotes;
+
+    vector<FlatRef> children;  // Shared buffer for the Ranges.
+    StringInterner strings;
+
+    FlatRef add_char(char32_t c);
+    FlatRef add_num(string_view x);
+    FlatRef add_sym(string_view name);
+    FlatRef add_str(string_view xs);
+    FlatRef add_tuple(const FlatRef* first, const FlatRef* last);
+    FlatRef add_apply(FlatRef lambda, const FlatRef* first_arg, const FlatRef* last_arg);
+    FlatRef add_quote(FlatRef expr);
+
+    // Children of a Tuple or the arguments of an Apply.
+    const FlatRef* begin(Range r) const { return children.data() + r.begin; }
+    const FlatRef* end(Range r) const { return children.data() + r.begin + r.size; }
+
+    const string& string_of(FlatRef r) const;  // Num, Sym or Str.
+
+    // Rebuild a Node tree from `r`, for the values of literals and quoted expressions. Builtin
+    // names become the canonical SymLeafs of BuiltinNames.
+    Node* export_(FlatRef r, Arena& storage) const;
+
+    size_t n_nodes() const;
+    // Bytes held by the store, including interned strings.
+    size_t bytes() const;
+};
+
+void dump(const FlatAst& ast, FlatRef r);
+
+}  // namespace forrest
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ast.h"
+
+namespace forrest {
+
+// Compiled form of a `fn` body. Symbols referring to parameters of the enclosing `fn`s are resolved
+// to (depth, slot) coordinates at compile time, so a call binds the arguments in a flat Frame and
+// runs the Code without looking at the syntax tree again.
+struct Code
+{
+    enum Op
+    {
+        CONST,         // Literal or quoted expression: `node`.
+        PARAM,         // Parameter `slot` of the frame `depth` levels up.
+        SYMBOL,        // Builtin or top-level symbol `node`, resolved when executed.
+        TUPLE,         // Evaluate `xs` into a new TupleNode.
+        APPLY,         // xs[0] is the function, the rest are the arguments.
+        MAKE_CLOSURE,  // Capture the current frame into a ClosureNode of `fn`.
+    };
+
+    const Op op;
+    Node* node = nullptr;
+    int depth = 0;
+    int slot = 0;
+    const Code* const* xs = nullptr;
+    int n_xs = 0;
+    const FnCode* fn = nullptr;
+
+    explicit Code(Op op) : op(op) {}
+};
+
+struct FnCode
+{
+    const int n_pars;
+    const Code* const body;
+    FnCode(int n_pars, const Code* body) : n_pars(n_pars), body(body) {}
+};
+
+// Activation record of a `fn` call.
+struct Frame
+{
+    const Frame* const parent;  // Frame the closure was created in.
+    Node* const* const slots;   // FnCode::n_pars arguments.
+    Frame(const Frame* parent, Node* const* slots) : parent(parent), slots(slots) {}
+};
+
+}  // namespace forrest
@@ -8,6 +8,7 @@
 #include "util/arena.h"
 #include "util/filereader.h"
 #include "util/log.h"
+#include "util/timing.h"
 
 #include "ast.h"
 #include "ast_builder.h"
@@ -28,19 +29,33 @@ using std::vector;
 static const char* const USAGE_TEXT =
     R"~~~~(%1$s: parse forrest-AST text file
 Usage: %1$s --help
-       %1$s <input-files> [--cpp-out <filename>]
+       %1$s <input-files> [--cpp-out <filename>] [--time-report] [--trace-out <filename>]
+
+--time-report prints the time spent in the compiler phases and the memory held by the AST and the
+arenas to stderr, --trace-out <filename> writes the phases as Chrome trace-event JSON.
 )~~~~";
 
 // Add parsed data to ast.
-maybe<vector<Node*>> parse_fast_file_add_to_ast(const string& filename, Arena& storage)
+maybe<vector<FlatRef>> parse_fast_file_add_to_ast(const string& filename, FlatAst& ast)
 {
+    TIME_SCOPE("parse_fast_file_add_to_ast");
     auto lr = FileReader::new_(filename);
     if (is_left(lr)) {
         report_error(left(lr));
         return {};
     }
     // Call AstBuilder with new FileReader.
-    return AstBuilder::parse_filereader_into_ast(right(lr), storage);
+    return AstBuilder::parse_filereader_into_ast(right(lr), ast);
+}
+
+void print_arena_stats(const char* name, const Arena& arena)
+{
+    auto s = arena.stats();
+    fprintf(stderr,
+            "%s arena: %zu pages (%zu in use), %zu bytes used, %zu wasted to alignment, %zu at page "
+            "ends, %zu large blocks\n",
+            name, s.pages, s.used_pages, s.bytes_used, s.bytes_wasted_to_alignment,
+            s.bytes_wasted_at_page_ends, s.large_blocks);
 }
 
 int run_fc_with_parsed_command_line(const CommandLineOptions& o)
@@ -51,10 +66,10 @@ int run_fc_with_parsed_command_line(const CommandLineOptions& o)
     }
 
     bool ok = true;
-    Arena storage;
-    vector<Node*> top_level_exprs;
+    FlatAst ast;
+    vector<FlatRef> top_level_exprs;
     for (auto& f : o.files) {
-        auto m_exprs = parse_fast_file_add_to_ast(f, storage);
+        auto m_exprs = parse_fast_file_add_to_ast(f, ast);
         if (m_exprs) {
             absl::PrintF("Compiled %s\n", f);
             top_level_exprs.insert(top_level_exprs.end(), BE(*m_exprs));
@@ -66,23 +81,26 @@ int run_fc_with_parsed_command_line(const CommandLineOptions& o)
         return EXIT_FAILURE;
     }
     // Dump top level expressions.
-    printf("Top level expressions.\n");
-    for (auto x : top_level_exprs)
-        dump(x);
+    {
+        TIME_SCOPE("dump");
+        printf("Top level expressions.\n");
+        for (auto x : top_level_exprs)
+            dump(ast, x);
+    }
 
+    TIME_SCOPE("eval");
     Shell shell;
     for (auto x : top_level_exprs) {
-        auto lr = shell.eval(x);
+        auto lr = shell.eval(ast, x);
         if (is_left(lr)) {
             fprintf(stderr, "Error: %s\n", left(lr).msg.c_str());
             return EXIT_FAILURE;
         }
     }
-
-    for (auto& kv : shell.symbols) {
-        auto& s = kv.first;
-        auto& v = kv.second;
-        int a = 3;
+    if (o.time_report) {
+        fprintf(stderr, "AST: %zu nodes, %zu bytes\n", ast.n_nodes(), ast.bytes());
+        print_arena_stats("Eval", shell.storage);
+        print_arena_stats("Code", shell.code_storage);
     }
 
     return EXIT_SUCCESS;
@@ -103,7 +121,19 @@ int c2main(int argc, const char** argv)
         PrintF(USAGE_TEXT, PROGRAM_NAME);
         result = EXIT_SUCCESS;
     } else {
+        if (cl.time_report || !cl.trace_out.empty()) {
+            enable_timing();
+        }
         result = run_fc_with_parsed_command_line(cl);
+        if (g_timing.enabled) {
+            disable_timing();
+            if (cl.time_report) {
+                print_time_report(stderr);
+            }
+            if (!cl.trace_out.empty() && !write_chrome_trace(cl.trace_out)) {
+                result = EXIT_FAILURE;
+            }
+        }
     }
     return result;
 }
@@ -11,75 +11,485 @@ namespace forrest {
 
 using std::get_if;
 
-struct Lambda
-{
-    vector<const char*> pars;
-    Node* body;
-};
-
 using std::array;
 using std::unique_ptr;
 using std::visit;
 
-maybe<Lambda> try_get_fn_expr(Node* e)
+// Parameter list of an evaluated `fn` form: a tuple of symbols.
+maybe<vector<const string*>> try_get_fn_pars(Node* e)
+{
+    auto t = e->try_cast<tag::Tuple>();
+    if (!t)
+        return {};
+    vector<const string*> pars;
+    pars.reserve(t->xs.size());
+    for (auto x : t->xs) {
+        auto p = x->try_cast<tag::Sym>();
+        if (!p)
+            return {};
+        pars.emplace_back(&p->name);
+    }
+    return pars;
+}
+
+struct FnForm
+{
+    vector<const string*> pars;
+    Node* body;
+};
+
+// Unevaluated `fn` form: {fn (`a `b) `body} or {fn `(a b) `body}.
+maybe<FnForm> try_get_fn_form(Node* e)
 {
-    // e must be ApplyNode.
     auto apply_node = e->try_cast<tag::Apply>();
     if (!apply_node)
         return {};
-    // Lambda must be the builtin FN SymLeaf.
     auto symleaf = apply_node->lambda->try_cast<tag::Sym>();
     if (!symleaf)
         return {};
-    if (symleaf != BuiltinNames::g->id_to_symleaf(BuiltinNames::FN)) {
+    if (symleaf != BuiltinNames::g->id_to_symleaf(BuiltinNames::FN))
         return {};
-    }
-    // xs should hold args and body
     auto& xs = apply_node->args->xs;
     if (xs.size() != 2)
         return {};
+    auto body = xs[1]->try_cast<tag::Quote>();
+    if (!body)
+        return {};
+    if (auto quoted_pars = xs[0]->try_cast<tag::Quote>()) {
+        auto m_pars = try_get_fn_pars(quoted_pars->expr);
+        if (!m_pars)
+            return {};
+        return FnForm{move(*m_pars), body->expr};
+    }
     auto args = xs[0]->try_cast<tag::Tuple>();
     if (!args)
         return {};
-    // args should be list of symbols
-    vector<const char*> lambda_args;
-    lambda_args.reserve(args->xs.size());
+    vector<const string*> pars;
+    pars.reserve(args->xs.size());
     for (auto& arg : args->xs) {
-        auto p_arg = arg->try_cast<tag::Sym>();
+        auto q_arg = arg->try_cast<tag::Quote>();
+        auto p_arg = q_arg ? q_arg->expr->try_cast<tag::Sym>() : nullptr;
         if (!p_arg)
             return {};
-        lambda_args.emplace_back(p_arg->name.c_str());
+        pars.emplace_back(&p_arg->name);
+    }
+    return FnForm{move(pars), body->expr};
+}
+
+struct FlatFnForm
+{
+    vector<const string*> pars;
+    FlatRef body;
+};
+
+// Same as try_get_fn_form(Node*), on the parsed FlatAst.
+maybe<FlatFnForm> try_get_fn_form(const FlatAst& ast, FlatRef e)
+{
+    if (e.kind() != NodeKind::Apply)
+        return {};
+    auto& apply = ast.applies[e.index()];
+    if (apply.lambda.kind() != NodeKind::Sym)
+        return {};
+    if (BuiltinNames::constexpr_string_to_id(ast.string_of(apply.lambda)) != BuiltinNames::FN)
+        return {};
+    if (apply.args.size != 2)
+        return {};
+    auto xs = ast.begin(apply.args);
+    if (xs[1].kind() != NodeKind::Quote)
+        return {};
+    auto body = ast.quotes[xs[1].index()];
+    vector<const string*> pars;
+    auto add_par = [&ast, &pars](FlatRef r) {
+        if (r.kind() != NodeKind::Sym)
+            return false;
+        pars.emplace_back(&ast.string_of(r));
+        return true;
+    };
+    if (xs[0].kind() == NodeKind::Quote) {
+        // {fn `(a b) `body}
+        auto quoted_pars = ast.quotes[xs[0].index()];
+        if (quoted_pars.kind() != NodeKind::Tuple)
+            return {};
+        auto& range = ast.tuples[quoted_pars.index()];
+        for (auto p = ast.begin(range); p != ast.end(range); ++p) {
+            if (!add_par(*p))
+                return {};
+        }
+        return FlatFnForm{move(pars), body};
+    }
+    // {fn (`a `b) `body}
+    if (xs[0].kind() != NodeKind::Tuple)
+        return {};
+    auto& range = ast.tuples[xs[0].index()];
+    for (auto p = ast.begin(range); p != ast.end(range); ++p) {
+        if (p->kind() != NodeKind::Quote || !add_par(ast.quotes[p->index()]))
+            return {};
+    }
+    return FlatFnForm{move(pars), body};
+}
+
+// Parameters of the enclosing `fn`s during compilation, innermost first.
+struct Shell::Scope
+{
+    const Scope* const parent;
+    const vector<const string*>& pars;
+
+    // Returns (depth, slot).
+    maybe<pair<int, int>> lookup(const string& name) const
+    {
+        int depth = 0;
+        for (auto s = this; s; s = s->parent, ++depth) {
+            FOR (i, 0, < ~s->pars) {
+                if (*s->pars[i] == name) {
+                    return pair<int, int>(depth, i);
+                }
+            }
+        }
+        return {};
     }
-    return Lambda{move(lambda_args), xs[1]};
 };
 
-maybe<Node*> Shell::resolveSymbol(const string& name)
+int Shell::slot_of(const string& name)
 {
-    auto m_id = BuiltinNames::g->string_to_id(name);
-    if (m_id) {
-        return BuiltinNames::g->id_to_symleaf(*m_id);
+    auto itb = global_slots.emplace(name, ~globals);
+    if (itb.second) {
+        globals.push_back(nullptr);
     }
-    auto it = symbols.find(name);
-    if (it == symbols.end())
+    return itb.first->second;
+}
+
+// Evaluator's symbol lookup, no string hashing after the first lookup of a SymLeaf.
+maybe<Node*> Shell::resolve(SymLeaf* p)
+{
+    if (BuiltinNames::g->is_builtin(p)) {
+        return p;
+    }
+    if (p->slot == SymLeaf::NO_SLOT) {
+        p->slot = slot_of(p->name);
+    }
+    auto v = globals[p->slot];
+    if (!v)
         return {};
-    return it->second;
+    return v;
 }
 
-Shell::EvalResult Shell::eval(Node* expr)
+Shell::EvalResult Shell::eval(const FlatAst& ast, FlatRef expr)
 {
-    Arena tmp_storage;
-    return eval(expr, tmp_storage);
+    // Results may be bound by `def` so they stay in `storage`, only the temporaries of a failed
+    // evaluation which hasn't bound anything are released.
+    auto m = storage.mark();
+    auto n_defs_before = n_defs;
+    auto er = eval(ast, expr, storage);
+    if (is_left(er) && n_defs == n_defs_before) {
+        storage.rewind(m);
+    }
+    return er;
 }
 
-Shell::EvalResult beta_reduction(const Lambda& lambda, const vector<Node*> evald_args)
+const FnCode* Shell::compile_fn(const vector<const string*>& pars,
+                                Node* body,
+                                const Scope* scope)
 {
-    // todo
+    Scope inner_scope{scope, pars};
+    return code_storage.new_<FnCode>(~pars, compile(body, &inner_scope));
 }
 
-Shell::EvalResult Shell::eval_fn(const vector<Node*>& evald_args)
+const FnCode* Shell::compile_fn(const vector<const string*>& pars,
+                                const FlatAst& ast,
+                                FlatRef body,
+                                const Scope* scope)
+{
+    Scope inner_scope{scope, pars};
+    return code_storage.new_<FnCode>(~pars, compile(ast, body, &inner_scope));
+}
+
+const Code* Shell::compile(Node* expr, const Scope* scope)
+{
+    struct Visitor
+    {
+        Shell& shell;
+        const Scope* scope;
+
+        const Code* constant(Node* node)
+        {
+            auto c = shell.code_storage.new_<Code>(Code::CONST);
+            c->node = node;
+            return c;
+        }
+        const Code* sequence(Code::Op op, Node* head, const vector<Node*>& xs)
+        {
+            auto c = shell.code_storage.new_<Code>(op);
+            c->n_xs = ~xs + (head ? 1 : 0);
+            auto ys = (const Code**)shell.code_storage.allocate_block(
+                c->n_xs * sizeof(const Code*), alignof(const Code*));
+            int i = 0;
+            if (head) {
+                ys[i++] = visit(*this, head->thisv());
+            }
+            for (auto x : xs) {
+                ys[i++] = visit(*this, x->thisv());
+            }
+            c->xs = ys;
+            return c;
+        }
+
+        const Code* operator()(TupleNode* p) { return sequence(Code::TUPLE, nullptr, p->xs); }
+        const Code* operator()(StrNode* p) { return constant(p); }
+        const Code* operator()(SymLeaf* p)
+        {
+            if (scope) {
+                if (auto m_coords = scope->lookup(p->name)) {
+                    auto c = shell.code_storage.new_<Code>(Code::PARAM);
+                    c->depth = m_coords->first;
+                    c->slot = m_coords->second;
+                    return c;
+                }
+            }
+            auto c = shell.code_storage.new_<Code>(Code::SYMBOL);
+            c->node = p;
+            return c;
+        }
+        const Code* operator()(NumLeaf* p) { return constant(p); }
+        const Code* operator()(CharLeaf* p) { return constant(p); }
+        const Code* operator()(ApplyNode* p)
+        {
+            // A nested `fn` form (unless `fn` is shadowed by a parameter) is compiled here once,
+            // executing it only captures the frame.
+            auto symleaf = p->lambda->try_cast<tag::Sym>();
+            if (symleaf && !(scope && scope->lookup(symleaf->name))) {
+                if (auto m_fn_form = try_get_fn_form(p)) {
+                    auto c = shell.code_storage.new_<Code>(Code::MAKE_CLOSURE);
+                    c->fn = shell.compile_fn(m_fn_form->pars, m_fn_form->body, scope);
+                    return c;
+                }
+            }
+            return sequence(Code::APPLY, p->lambda, p->args->xs);
+        }
+        const Code* operator()(QuoteNode* p) { return constant(p->expr); }
+        const Code* operator()(ClosureNode* p) { return constant(p); }
+    };
+    return visit(Visitor{*this, scope}, expr->thisv());
+}
+
+const Code* Shell::compile(const FlatAst& ast, FlatRef expr, const Scope* scope)
+{
+    struct Compiler
+    {
+        Shell& shell;
+        const FlatAst& ast;
+        const Scope* scope;
+
+        // Literals and quoted expressions become Nodes once, here, as the values of CONST codes.
+        const Code* constant(FlatRef r)
+        {
+            auto c = shell.code_storage.new_<Code>(Code::CONST);
+            c->node = ast.export_(r, shell.code_storage);
+            return c;
+        }
+        const Code* sequence(Code::Op op, const FlatRef* head, FlatAst::Range xs)
+        {
+            auto c = shell.code_storage.new_<Code>(op);
+            c->n_xs = int(xs.size) + (head ? 1 : 0);
+            auto ys = (const Code**)shell.code_storage.allocate_block(
+                c->n_xs * sizeof(const Code*), alignof(const Code*));
+            int i = 0;
+            if (head) {
+                ys[i++] = compile(*head);
+            }
+            for (auto p = ast.begin(xs); p != ast.end(xs); ++p) {
+                ys[i++] = compile(*p);
+            }
+            c->xs = ys;
+            return c;
+        }
+        const Code* symbol(FlatRef r)
+        {
+            auto& name = ast.string_of(r);
+            if (scope) {
+                if (auto m_coords = scope->lookup(name)) {
+                    auto c = shell.code_storage.new_<Code>(Code::PARAM);
+                    c->depth = m_coords->first;
+                    c->slot = m_coords->second;
+                    return c;
+                }
+            }
+            auto c = shell.code_storage.new_<Code>(Code::SYMBOL);
+            auto symleaf = ast.export_(r, shell.code_storage)->try_cast<tag::Sym>();
+            if (!BuiltinNames::g->is_builtin(symleaf)) {
+                symleaf->slot = shell.slot_of(name);
+            }
+            c->node = symleaf;
+            return c;
+        }
+        const Code* apply(FlatRef r)
+        {
+            // A nested `fn` form (unless `fn` is shadowed by a parameter) is compiled here once,
+            // executing it only captures the frame.
+            auto& a = ast.applies[r.index()];
+            if (a.lambda.kind() == NodeKind::Sym &&
+                !(scope && scope->lookup(ast.string_of(a.lambda)))) {
+                if (auto m_fn_form = try_get_fn_form(ast, r)) {
+                    auto c = shell.code_storage.new_<Code>(Code::MAKE_CLOSURE);
+                    c->fn = shell.compile_fn(m_fn_form->pars, ast, m_fn_form->body, scope);
+                    return c;
+                }
+            }
+            return sequence(Code::APPLY, &a.lambda, a.args);
+        }
+        const Code* compile(FlatRef r)
+        {
+            switch (r.kind()) {
+                case NodeKind::Char:
+                case NodeKind::Num:
+                case NodeKind::Str:
+                    return constant(r);
+                case NodeKind::Sym:
+                    return symbol(r);
+                case NodeKind::Tuple:
+                    return sequence(Code::TUPLE, nullptr, ast.tuples[r.index()]);
+                case NodeKind::Apply:
+                    return apply(r);
+                case NodeKind::Quote:
+                    return constant(ast.quotes[r.index()]);
+            }
+            UL_UNREACHABLE;
+        }
+    };
+    return Compiler{*this, ast, scope}.compile(expr);
+}
+
+Shell::EvalResult Shell::run(const Code* code, const Frame* frame, Arena& storage)
+{
+    switch (code->op) {
+        case Code::CONST:
+            return code->node;
+        case Code::PARAM: {
+            auto f = frame;
+            FOR (i, 0, < code->depth) {
+                f = f->parent;
+            }
+            return f->slots[code->slot];
+        }
+        case Code::SYMBOL: {
+            auto symleaf = code->node->try_cast<tag::Sym>();
+            auto me = resolve(symleaf);
+            if (me) {
+                return *me;
+            }
+            return EvalError{string("Unknown symbol: ") + symleaf->name};
+        }
+        case Code::TUPLE: {
+            vector<Node*> evald_xs;
+            evald_xs.reserve(code->n_xs);
+            FOR (i, 0, < code->n_xs) {
+                auto er = run(code->xs[i], frame, storage);
+                if (is_left(er))
+                    return er;
+                evald_xs.emplace_back(right(er));
+            }
+            return storage.new_<TupleNode>(BE(evald_xs));
+        }
+        case Code::APPLY: {
+            // Arguments first, then the function, like eval().
+            vector<Node*> evald_args;
+            evald_args.reserve(code->n_xs - 1);
+            FOR (i, 1, < code->n_xs) {
+                auto er = run(code->xs[i], frame, storage);
+                if (is_left(er))
+                    return er;
+                evald_args.emplace_back(right(er));
+            }
+            auto er_lambda = run(code->xs[0], frame, storage);
+            if (is_left(er_lambda))
+                return er_lambda;
+            return apply(right(er_lambda), evald_args, storage);
+        }
+        case Code::MAKE_CLOSURE:
+            return storage.new_<ClosureNode>(code->fn, frame);
+    }
+    UL_UNREACHABLE;
+}
+
+Shell::EvalResult Shell::apply(Node* evald_lambda, const vector<Node*>& evald_args, Arena& storage)
+{
+    // Check if builtin.
+    auto symleaf = evald_lambda->try_cast<tag::Sym>();
+    if (symleaf) {
+        if (symleaf == BuiltinNames::g->id_to_symleaf(BuiltinNames::FN)) {
+            return eval_fn(evald_args, storage);
+        } else if (symleaf == BuiltinNames::g->id_to_symleaf(BuiltinNames::DEF)) {
+            return eval_def(evald_args);
+        }
+    }
+    if (auto closure = evald_lambda->try_cast<tag::Closure>()) {
+        return apply_closure(closure, evald_args, storage);
+    }
+    // A quoted `fn` form used as a value, compile it on first use.
+    auto it = fn_form_closures.find(evald_lambda);
+    if (it == fn_form_closures.end()) {
+        auto m_fn_form = try_get_fn_form(evald_lambda);
+        if (!m_fn_form) {
+            return EvalError{"First element is not a lambda."};
+        }
+        auto closure = code_storage.new_<ClosureNode>(
+            compile_fn(m_fn_form->pars, m_fn_form->body, nullptr), nullptr);
+        it = fn_form_closures.emplace(evald_lambda, closure).first;
+    }
+    return apply_closure(it->second, evald_args, storage);
+}
+
+Shell::EvalResult Shell::apply_closure(ClosureNode* closure,
+                                       const vector<Node*>& evald_args,
+                                       Arena& storage)
+{
+    auto fn = closure->fn;
+    const vector<Node*>* args = &evald_args;
+    vector<Node*> all_args;
+    if (closure->n_bound_args > 0) {
+        all_args.reserve(closure->n_bound_args + evald_args.size());
+        all_args.insert(all_args.end(), closure->bound_args,
+                        closure->bound_args + closure->n_bound_args);
+        all_args.insert(all_args.end(), BE(evald_args));
+        args = &all_args;
+    }
+    if (~*args < fn->n_pars) {
+        // Currying: remember the arguments so far.
+        auto bound_args = (Node**)storage.allocate_block(~*args * sizeof(Node*), alignof(Node*));
+        std::copy(BE(*args), bound_args);
+        return storage.new_<ClosureNode>(fn, closure->env, bound_args, ~*args);
+    }
+    // The frame and the temporaries of the call are released on return, unless the result was
+    // allocated during the call (it may refer to the frame) or the call bound a global with `def`.
+    // Older nodes can't refer to newer ones, they are immutable.
+    auto m = storage.mark();
+    auto n_defs_before = n_defs;
+    auto slots = (Node**)storage.allocate_block(fn->n_pars * sizeof(Node*), alignof(Node*));
+    std::copy(args->begin(), args->begin() + fn->n_pars, slots);
+    auto er = run(fn->body, storage.new_<Frame>(closure->env, slots), storage);
+    if (n_defs == n_defs_before && (is_left(er) || !storage.allocated_since(m, right(er)))) {
+        storage.rewind(m);
+    }
+    if (is_left(er) || ~*args == fn->n_pars) {
+        return er;
+    }
+    // More arguments than parameters, the result must be callable with the rest.
+    return apply(right(er), vector<Node*>(args->begin() + fn->n_pars, args->end()), storage);
+}
+
+Shell::EvalResult Shell::eval_fn(const vector<Node*>& evald_args, Arena& storage)
 {
     // @1 must be list of symbols
     // @2 must be body
+    // There's no enclosing frame here, the body can refer to its own parameters and to top-level
+    // symbols only.
+    if (evald_args.size() != 2) {
+        return EvalError{"fn needs 2 args"};
+    }
+    auto m_pars = try_get_fn_pars(evald_args[0]);
+    if (!m_pars) {
+        return EvalError{"fn first arg must be tuple of syms"};
+    }
+    return storage.new_<ClosureNode>(compile_fn(*m_pars, evald_args[1], nullptr), nullptr);
 }
 
 Shell::EvalResult Shell::eval_def(const vector<Node*>& evald_args)
@@ -92,83 +502,84 @@ Shell::EvalResult Shell::eval_def(const vector<Node*>& evald_args)
     if (!sym) {
         return EvalError{"def first arg must be sym"};
     }
-    if (symbols.find(sym->name) != symbols.end()) {
+    if (BuiltinNames::g->is_builtin(sym) || resolve(sym)) {
         return EvalError{"def first arg must be unbound sym"};
     }
     // @2 must be value to set
-    symbols[sym->name] = evald_args[1];
+    globals[sym->slot] = evald_args[1];
+    ++n_defs;
     return sym;
 }
 
-Shell::EvalResult Shell::eval(Node* expr, Arena& storage)
+Shell::EvalResult Shell::eval(const FlatAst& ast, FlatRef expr, Arena& storage)
 {
-    struct Visitor
+    // Top-level expressions are evaluated once, walking the FlatAst. Only `fn` bodies are compiled.
+    struct Evaluator
     {
         Shell& shell;
+        const FlatAst& ast;
         Arena& storage;
-        explicit Visitor(Shell& shell, Arena& storage) : shell(shell), storage(storage) {}
 
-        EvalResult operator()(TupleNode* p)
+        EvalResult eval(FlatRef r)
         {
-            vector<Node*> evald_xs;
-            for (auto x : p->xs) {
-                auto er = visit(*this, x->thisv());
-                if (is_left(er))
-                    return left(er);
-                evald_xs.emplace_back(right(er));
+            switch (r.kind()) {
+                case NodeKind::Char:
+                case NodeKind::Num:
+                case NodeKind::Str:
+                    return ast.export_(r, storage);
+                case NodeKind::Sym: {
+                    auto& name = ast.string_of(r);
+                    if (auto m_id = BuiltinNames::string_to_id(name)) {
+                        return BuiltinNames::g->id_to_symleaf(*m_id);
+                    }
+                    if (auto v = shell.globals[shell.slot_of(name)]) {
+                        return v;
+                    }
+                    return EvalError{string("Unknown symbol: ") + name};
+                }
+                case NodeKind::Tuple: {
+                    auto& range = ast.tuples[r.index()];
+                    vector<Node*> evald_xs;
+                    evald_xs.reserve(range.size);
+                    for (auto p = ast.begin(range); p != ast.end(range); ++p) {
+                        auto er = eval(*p);
+                        if (is_left(er))
+                            return er;
+                        evald_xs.emplace_back(right(er));
+                    }
+                    return storage.new_<TupleNode>(BE(evald_xs));
+                }
+                case NodeKind::Apply:
+                    return apply(r);
+                case NodeKind::Quote:
+                    return ast.export_(ast.quotes[r.index()], storage);
             }
-            // Here we have an evaluated tuple
-            return storage.new_<TupleNode>(BE(evald_xs));
+            UL_UNREACHABLE;
         }
-        EvalResult operator()(StrNode* p) { return p; }
-        EvalResult operator()(SymLeaf* p)
+        EvalResult apply(FlatRef r)
         {
-            auto me = shell.resolveSymbol(p->name);
-            if (me) {
-                return *me;
+            // A `fn` form is compiled from the FlatAst, without exporting its quoted parts.
+            if (auto m_fn_form = try_get_fn_form(ast, r)) {
+                return storage.new_<ClosureNode>(
+                    shell.compile_fn(m_fn_form->pars, ast, m_fn_form->body, nullptr), nullptr);
             }
-            return EvalError{string("Unknown symbol: ") + p->name};
-        }
-        EvalResult operator()(NumLeaf* p) { return p; }
-        EvalResult operator()(CharLeaf* p) { return p; }
-        EvalResult operator()(ApplyNode* p)
-        {
+            auto& a = ast.applies[r.index()];
             vector<Node*> evald_args;
-            auto args_xs = p->args->xs;
-            evald_args.reserve(args_xs.size());
-            for (auto e : p->args->xs) {
-                auto er = visit(*this, e->thisv());
-                if (is_left(er)) {
+            evald_args.reserve(a.args.size);
+            for (auto p = ast.begin(a.args); p != ast.end(a.args); ++p) {
+                auto er = eval(*p);
+                if (is_left(er))
                     return er;
-                }
                 evald_args.emplace_back(right(er));
             }
-
-            auto er_lambda = visit(*this, p->lambda->thisv());
+            auto er_lambda = eval(a.lambda);
             if (is_left(er_lambda))
                 return er_lambda;
-            // Check if builtin.
-            auto evald_lambda = right(er_lambda);
-            auto symleaf = evald_lambda->try_cast<tag::Sym>();
-            if (symleaf) {
-                if (symleaf == BuiltinNames::g->id_to_symleaf(BuiltinNames::FN)) {
-                    return shell.eval_fn(evald_args);
-                } else if (symleaf == BuiltinNames::g->id_to_symleaf(BuiltinNames::DEF)) {
-                    return shell.eval_def(evald_args);
-                }
-            }
-            auto m_lambda = try_get_fn_expr(evald_lambda);
-            if (!m_lambda) {
-                return EvalError{"First element is not a lambda."};
-            };
-
-            // Bind evald_args to lambda.pars in lambda.body.
-            // The can be less args then pars, then it's currying.
-            return beta_reduction(*m_lambda, evald_args);
+            // There can be less args than pars, then it's currying.
+            return shell.apply(right(er_lambda), evald_args, storage);
         }
-        EvalResult operator()(QuoteNode* p) { return p->expr; }
     };
-    return visit(Visitor{*this, storage}, expr->thisv());
+    return Evaluator{*this, ast, storage}.eval(expr);
 }
 
-}  // namespace forrest
\ No newline at end of file
+}  // namespace forrest
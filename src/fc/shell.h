@@ -8,6 +8,8 @@
 #include "util/either.h"
 
 #include "ast.h"
+#include "flat_ast.h"
+#include "fncode.h"
 
 namespace forrest {
 
@@ -15,14 +17,46 @@ using std::unordered_map;
 
 struct Shell
 {
-    struct EvalErroriik maybe<Node*> resolveSymbol(const string& name);
-    EvalResult eval(Node* expr);
-    EvalResult eval(Node* expr, Arena& storage);
-
-    unordered_map<string, Node*> symbols;
+    struct EvalError
+    {
+        string msg;
+    };
+    using EvalResult = either<EvalError, Node*>;
+
+    // Evaluate a top-level expression of `ast`.
+    EvalResult eval(const FlatAst& ast, FlatRef expr);
+    EvalResult eval(const FlatAst& ast, FlatRef expr, Arena& storage);
+
+    vector<Node*> globals;  // Values of the top-level symbols, nullptr if not yet defined.
+    unordered_map<string, int> global_slots;
+    Arena storage;       // Values produced by eval() and call frames.
+    Arena code_storage;  // Compiled code and the constants it refers to, never rewound.
+    // Closures compiled from quoted `fn` forms used as functions, keyed by the form.
+    unordered_map<Node*, ClosureNode*> fn_form_closures;
 
 private:
-    EvalResult eval_fn(const vector<Node*>& evald_args);
+    struct Scope;
+
+    int n_defs = 0;
+
+    int slot_of(const string& name);
+    maybe<Node*> resolve(SymLeaf* p);
+
+    // Values and call frames are allocated in `storage`.
+    EvalResult apply(Node* evald_lambda, const vector<Node*>& evald_args, Arena& storage);
+    EvalResult apply_closure(ClosureNode* closure,
+                             const vector<Node*>& evald_args,
+                             Arena& storage);
+    EvalResult run(const Code* code, const Frame* frame, Arena& storage);
+    // `fn` bodies built at run time are compiled from Nodes, the parsed program from the FlatAst.
+    const Code* compile(Node* expr, const Scope* scope);
+    const Code* compile(const FlatAst& ast, FlatRef expr, const Scope* scope);
+    const FnCode* compile_fn(const vector<const string*>& pars, Node* body, const Scope* scope);
+    const FnCode* compile_fn(const vector<const string*>& pars,
+                             const FlatAst& ast,
+                             FlatRef body,
+                             const Scope* scope);
+    EvalResult eval_fn(const vector<Node*>& evald_args, Arena& storage);
     EvalResult eval_def(const vector<Node*>& evald_args);
 };
 
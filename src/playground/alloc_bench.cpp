@@ -0,0 +1,100 @@
+// Measures building, traversing and destroying the node types of the compilers (forrest::Node
+// trees of fc, bst::Expr trees of c2 and snl::Term DAGs of src2) with different allocators: the
+// global operator new, forrest::Arena with heap and with mmap pages, a pool of per-size slabs and
+// a monotonic buffer resource.
+//
+// Usage: alloc_bench [--repetitions <n>] [--json <filename>]
+//
+// Prints a table to stdout and optionally writes the results as JSON. The shapes of the inputs
+// are fixed so the node counts, bytes and allocations are the same from run to run. The bytes and
+// allocations are counted only if built with FORREST_ALLOC_TRACKING.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "alloc_bench.h"
+
+using namespace alloc_bench;
+
+namespace {
+
+#if FORREST_ALLOC_TRACKING
+const bool ALLOC_TRACKING = true;
+#else
+const bool ALLOC_TRACKING = false;
+#endif
+
+bool write_json(const string& path, const Config& config, const vector<Result>& results)
+{
+    auto f = fopen(path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Can't open %s for writing.\n", path.c_str());
+        return false;
+    }
+    fprintf(f,
+            "{\"config\":{\"repetitions\":%d,\"tree_levels\":%d,\"dag_width\":%d,"
+            "\"dag_depth\":%d,\"alloc_tracking\":%s},\n\"results\":[\n",
+            config.repetitions, config.tree_levels, config.dag_width, config.dag_depth,
+            ALLOC_TRACKING ? "true" : "false");
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        fprintf(f,
+                "{\"node_type\":\"%s\",\"allocator\":\"%s\",\"nodes\":%lld,"
+                "\"build_ns_per_node\":%.3f,\"traverse_ns_per_node\":%.3f,"
+                "\"destroy_ns_per_node\":%.3f,\"bytes_per_node\":%.3f,"
+                "\"allocs_per_node\":%.3f}%s\n",
+                r.node_type.c_str(), r.allocator.c_str(), (long long)r.nodes, r.build_ns_per_node,
+                r.traverse_ns_per_node, r.destroy_ns_per_node, r.bytes_per_node,
+                r.allocs_per_node, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Error writing %s.\n", path.c_str());
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    Config config;
+    string json_path;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--repetitions") == 0) {
+            config.repetitions = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--json") == 0) {
+            json_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--repetitions <n>] [--json <filename>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.repetitions < 1) {
+        fprintf(stderr, "The number of repetitions must be positive.\n");
+        return EXIT_FAILURE;
+    }
+
+    vector<Result> results;
+    run_fc_node_benchmarks(config, results);
+    run_bst_expr_benchmarks(config, results);
+    run_snl_term_benchmarks(config, results);
+
+    printf("%-20s %-10s %8s %12s %12s %12s %12s %12s\n", "node type", "allocator", "nodes",
+           "build ns", "traverse ns", "destroy ns", "bytes", "allocs");
+    for (auto& r : results) {
+        printf("%-20s %-10s %8lld %12.2f %12.2f %12.2f %12.2f %12.2f\n", r.node_type.c_str(),
+               r.allocator.c_str(), (long long)r.nodes, r.build_ns_per_node,
+               r.traverse_ns_per_node, r.destroy_ns_per_node, r.bytes_per_node,
+               r.allocs_per_node);
+    }
+    printf("(per node, times are the median of %d repetitions)\n", config.repetitions);
+
+    if (!json_path.empty() && !write_json(json_path, config, results)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+// Allocator benchmark for the node types of the compilers, see alloc_bench.cpp.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/alloc_tracking.h"
+#include "util/arena.h"
+
+namespace alloc_bench {
+
+using std::string;
+using std::vector;
+
+struct Config
+{
+    int repetitions = 5;  // Times are the median of the repetitions.
+    int tree_levels = 9;  // Trees have 4 children per node.
+    int dag_width = 1000;
+    int dag_depth = 300;
+};
+
+struct Result
+{
+    string node_type;
+    string allocator;
+    int64_t nodes;
+    double build_ns_per_node;
+    double traverse_ns_per_node;
+    double destroy_ns_per_node;
+    // All heap allocations while building, including the pages of the allocator and the
+    // containers inside the nodes.
+    double bytes_per_node;
+    double allocs_per_node;
+};
+
+// The allocators have allocate(size, alignment) and deallocate(p, size, alignment), memory which
+// is not deallocated is released with the allocator.
+
+class MallocAllocator
+{
+public:
+    static constexpr const char* NAME = "malloc";
+    void* allocate(size_t size, size_t) { return ::operator new(size); }
+    void deallocate(void* p, size_t, size_t) { ::operator delete(p); }
+};
+
+class ArenaAllocator
+{
+public:
+    static constexpr const char* NAME = "arena";
+    void* allocate(size_t size, size_t alignment) { return arena.allocate_block(size, alignment); }
+    void deallocate(void*, size_t, size_t) {}
+
+private:
+    forrest::Arena arena;
+};
+
+// Pages mapped in 2 MB runs advised to use transparent huge pages. The pages don't come from
+// operator new, they are missing from bytes_per_node.
+class ArenaMmapAllocator
+{
+public:
+    static constexpr const char* NAME = "arena_mmap";
+    void* allocate(size_t size, size_t alignment) { return arena.allocate_block(size, alignment); }
+    void deallocate(void*, size_t, size_t) {}
+
+private:
+    forrest::Arena arena{forrest::Arena::PageSource::Mmap};
+};
+
+// Free list per size class, each class carves its blocks from its own slabs.
+class SlabPoolAllocator
+{
+public:
+    static constexpr const char* NAME = "slab_pool";
+    static const size_t GRANULE = 16;
+    static const size_t MAX_SIZE = 512;
+    static const size_t SLAB_SIZE = 65536;
+
+    SlabPoolAllocator() : classes(MAX_SIZE / GRANULE) {}
+    SlabPoolAllocator(const SlabPoolAllocator&) = delete;
+    ~SlabPoolAllocator()
+    {
+        for (auto p : slabs) {
+            ::operator delete(p);
+        }
+    }
+
+    void* allocate(size_t size, size_t alignment)
+    {
+        if (size > MAX_SIZE || alignment > GRANULE) {
+            return ::operator new(size);
+        }
+        auto& c = classes[size_class(size)];
+        if (c.free_list) {
+            auto p = c.free_list;
+            c.free_list = *static_cast<void**>(p);
+            return p;
+        }
+        auto block_size = (size_class(size) + 1) * GRANULE;
+        if (c.next + block_size > c.end) {
+            slabs.push_back(::operator new(SLAB_SIZE));
+            c.next = static_cast<char*>(slabs.back());
+            c.end = c.next + SLAB_SIZE;
+        }
+        auto p = c.next;
+        c.next += block_size;
+        return p;
+    }
+    void deallocate(void* p, size_t size, size_t alignment)
+    {
+        if (size > MAX_SIZE || alignment > GRANULE) {
+            ::operator delete(p);
+            return;
+        }
+        auto& c = classes[size_class(size)];
+        *static_cast<void**>(p) = c.free_list;
+        c.free_list = p;
+    }
+
+private:
+    struct SizeClass
+    {
+        void* free_list = nullptr;
+        char* next = nullptr;
+        char* end = nullptr;
+    };
+    vector<SizeClass> classes;
+    vector<void*> slabs;
+
+    static size_t size_class(size_t size) { return size == 0 ? 0 : (size - 1) / GRANULE; }
+};
+
+class MonotonicAllocator
+{
+public:
+    static constexpr const char* NAME = "monotonic";
+    void* allocate(size_t size, size_t alignment) { return resource.allocate(size, alignment); }
+    void deallocate(void* p, size_t size, size_t alignment)
+    {
+        resource.deallocate(p, size, alignment);  // No-op.
+    }
+
+private:
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+template <class T, class Allocator, class... Args>
+T* make(Allocator& a, Args&&... args)
+{
+    return new (a.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template <class T, class Allocator>
+void destroy(Allocator& a, T* p)
+{
+    p->~T();
+    a.deallocate(p, sizeof(T), alignof(T));
+}
+
+// A benchmark is a class template on the allocator with
+//   explicit Bench(const Config&)
+//   int64_t build(Allocator&)     Returns the number of nodes.
+//   int64_t traverse() const      Returns a checksum.
+//   void destroy(Allocator&)
+template <template <class> class Bench, class Allocator>
+Result run(const char* node_type, const Config& config)
+{
+    using clock = std::chrono::steady_clock;
+    auto ns = [](clock::duration d) {
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    };
+    Result r{node_type, Allocator::NAME, 0, 0, 0, 0, 0, 0};
+    vector<double> build, traverse, destroy;
+    int64_t checksum = 0;
+    for (int i = 0; i < config.repetitions; ++i) {
+        auto allocations_before = forrest::total_allocation_counters();
+        auto t0 = clock::now();
+        auto allocator = std::make_unique<Allocator>();
+        Bench<Allocator> bench(config);
+        r.nodes = bench.build(*allocator);
+        auto t1 = clock::now();
+        auto allocations_after = forrest::total_allocation_counters();
+        auto c = bench.traverse();
+        auto t2 = clock::now();
+        bench.destroy(*allocator);
+        allocator.reset();
+        auto t3 = clock::now();
+
+        assert(i == 0 || c == checksum);
+        checksum = c;
+        build.push_back(ns(t1 - t0));
+        traverse.push_back(ns(t2 - t1));
+        destroy.push_back(ns(t3 - t2));
+        r.bytes_per_node = double(allocations_after.bytes - allocations_before.bytes) / r.nodes;
+        r.allocs_per_node = double(allocations_after.allocs - allocations_before.allocs) / r.nodes;
+    }
+    auto median_per_node = [&r](vector<double>& xs) {
+        std::sort(xs.begin(), xs.end());
+        return xs[xs.size() / 2] / r.nodes;
+    };
+    r.build_ns_per_node = median_per_node(build);
+    r.traverse_ns_per_node = median_per_node(traverse);
+    r.destroy_ns_per_node = median_per_node(destroy);
+    return r;
+}
+
+template <template <class> class Bench>
+void run_with_all_allocators(const char* node_type, const Config& config, vector<Result>& results)
+{
+    results.push_back(run<Bench, MallocAllocator>(node_type, config));
+    results.push_back(run<Bench, ArenaAllocator>(node_type, config));
+    results.push_back(run<Bench, ArenaMmapAllocator>(node_type, config));
+    results.push_back(run<Bench, SlabPoolAllocator>(node_type, config));
+    results.push_back(run<Bench, MonotonicAllocator>(node_type, config));
+}
+
+// In their own translation units, the node types of the compilers don't mix.
+void run_fc_node_benchmarks(const Config& config, vector<Result>& results);
+void run_bst_expr_benchmarks(const Config& config, vector<Result>& results);
+void run_snl_term_benchmarks(const Config& config, vector<Result>& results);
+
+}  // namespace alloc_bench
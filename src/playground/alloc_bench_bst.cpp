@@ -0,0 +1,103 @@
+#include "alloc_bench.h"
+
+#include "c2/bst.h"
+
+namespace alloc_bench {
+
+using namespace forrest;
+
+namespace {
+
+template <class T>
+T* mutable_cast(const bst::Expr* e)
+{
+    return const_cast<T*>(static_cast<const T*>(e));
+}
+
+// Inner nodes are applications of a toplevel function, leaves are numbers.
+template <class Allocator>
+class BstExprBench
+{
+public:
+    explicit BstExprBench(const Config& config) : levels(config.tree_levels) {}
+
+    int64_t build(Allocator& a)
+    {
+        int64_t n = 0;
+        root = build_expr(a, levels, n);
+        return n;
+    }
+    int64_t traverse() const { return traverse_expr(root); }
+    void destroy(Allocator& a) { destroy_expr(a, root); }
+
+private:
+    int levels;
+    const bst::Expr* root = nullptr;
+
+    const bst::Expr* build_expr(Allocator& a, int level, int64_t& n)
+    {
+        if (level == 1) {
+            ++n;
+            return make<bst::Number>(a, std::to_string(n));
+        }
+        vector<const bst::Expr*> args;
+        args.reserve(4);
+        for (int i = 0; i < 4; ++i) {
+            args.push_back(build_expr(a, level - 1, n));
+        }
+        n += 2;
+        return make<bst::Fnapp>(a, make<bst::ToplevelVariableName>(a, "f"), move(args));
+    }
+    static int64_t traverse_expr(const bst::Expr* e)
+    {
+        switch (e->type) {
+            case bst::tNumber:
+                return int64_t(static_cast<const bst::Number*>(e)->x.size());
+            case bst::tToplevelVariableName:
+                return int64_t(static_cast<const bst::ToplevelVariableName*>(e)->name.size());
+            case bst::tFnapp: {
+                auto f = static_cast<const bst::Fnapp*>(e);
+                auto r = traverse_expr(f->fn_to_apply);
+                for (auto x : f->args) {
+                    r += traverse_expr(x);
+                }
+                return r;
+            }
+            default:
+                assert(false);
+                return 0;
+        }
+    }
+    // The destructor is virtual but deallocate needs the size of the concrete type.
+    static void destroy_expr(Allocator& a, const bst::Expr* e)
+    {
+        switch (e->type) {
+            case bst::tNumber:
+                alloc_bench::destroy(a, mutable_cast<bst::Number>(e));
+                break;
+            case bst::tToplevelVariableName:
+                alloc_bench::destroy(a, mutable_cast<bst::ToplevelVariableName>(e));
+                break;
+            case bst::tFnapp: {
+                auto f = mutable_cast<bst::Fnapp>(e);
+                destroy_expr(a, f->fn_to_apply);
+                for (auto x : f->args) {
+                    destroy_expr(a, x);
+                }
+                alloc_bench::destroy(a, f);
+                break;
+            }
+            default:
+                assert(false);
+        }
+    }
+};
+
+}  // namespace
+
+void run_bst_expr_benchmarks(const Config& config, vector<Result>& results)
+{
+    run_with_all_allocators<BstExprBench>("bst::Expr tree", config, results);
+}
+
+}  // namespace alloc_bench
@@ -0,0 +1,96 @@
+#include "alloc_bench.h"
+
+#include "fc/ast.h"
+
+namespace alloc_bench {
+
+using namespace forrest;
+
+namespace {
+
+// Inner nodes are (sym child...) applications, leaves are numbers.
+template <class Allocator>
+class FcNodeBench
+{
+public:
+    explicit FcNodeBench(const Config& config) : levels(config.tree_levels) {}
+
+    int64_t build(Allocator& a)
+    {
+        int64_t n = 0;
+        root = build_node(a, levels, n);
+        return n;
+    }
+    int64_t traverse() const { return traverse_node(root); }
+    void destroy(Allocator& a) { destroy_node(a, root); }
+
+private:
+    int levels;
+    Node* root = nullptr;
+
+    Node* build_node(Allocator& a, int level, int64_t& n)
+    {
+        if (level == 1) {
+            ++n;
+            return make<NumLeaf>(a, std::to_string(n));
+        }
+        Node* children[4];
+        for (auto& c : children) {
+            c = build_node(a, level - 1, n);
+        }
+        n += 3;
+        auto args = make<TupleNode>(a, std::begin(children), std::end(children));
+        return make<ApplyNode>(a, make<SymLeaf>(a, "f"), args);
+    }
+    static int64_t traverse_node(Node* node)
+    {
+        return std::visit(
+            [](auto* p) -> int64_t {
+                using T = std::remove_pointer_t<decltype(p)>;
+                if constexpr (std::is_same_v<T, NumLeaf>) {
+                    return int64_t(p->x.size());
+                } else if constexpr (std::is_same_v<T, SymLeaf>) {
+                    return int64_t(p->name.size());
+                } else if constexpr (std::is_same_v<T, TupleNode>) {
+                    int64_t r = 1;
+                    for (auto x : p->xs) {
+                        r += traverse_node(x);
+                    }
+                    return r;
+                } else if constexpr (std::is_same_v<T, ApplyNode>) {
+                    return traverse_node(p->lambda) + traverse_node(p->args);
+                } else {
+                    assert(false);
+                    return 0;
+                }
+            },
+            node->thisv());
+    }
+    // Node has no virtual destructor, each node is destroyed as its own type.
+    static void destroy_node(Allocator& a, Node* node)
+    {
+        std::visit(
+            [&a](auto* p) {
+                using T = std::remove_pointer_t<decltype(p)>;
+                if constexpr (std::is_same_v<T, TupleNode>) {
+                    for (auto x : p->xs) {
+                        destroy_node(a, x);
+                    }
+                } else if constexpr (std::is_same_v<T, ApplyNode>) {
+                    destroy_node(a, p->lambda);
+                    destroy_node(a, p->args);
+                }
+                alloc_bench::destroy(a, p);
+            },
+            node->thisv());
+    }
+};
+
+}  // namespace
+
+void run_fc_node_benchmarks(const Config& config, vector<Result>& results)
+{
+    run_with_all_allocators<FcNodeBench>("forrest::Node tree", config, results);
+}
+
+}  // namespace alloc_bench
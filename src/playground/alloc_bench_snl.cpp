@@ -0,0 +1,94 @@
+#include "alloc_bench.h"
+
+#include "term.h"
+
+namespace alloc_bench {
+
+using namespace snl;
+
+namespace {
+
+// Layers of applications over a layer of string literals, each term applies a term of the layer
+// below to two others so the terms are shared like the canonical terms of the Store.
+template <class Allocator>
+class SnlTermBench
+{
+public:
+    explicit SnlTermBench(const Config& config)
+        : width(config.dag_width), depth(config.dag_depth)
+    {}
+
+    int64_t build(Allocator& a)
+    {
+        layers.resize(depth);
+        for (int i = 0; i < width; ++i) {
+            layers[0].push_back(make<term::StringLiteral>(a, std::to_string(i)));
+        }
+        for (int d = 1; d < depth; ++d) {
+            auto& below = layers[d - 1];
+            for (int i = 0; i < width; ++i) {
+                vector<TermPtr> arguments{below[(i + 1) % width], below[(i * 7 + 3) % width]};
+                layers[d].push_back(make<term::Application>(a, below[i], move(arguments)));
+            }
+        }
+        return int64_t(width) * depth;
+    }
+    // Visits each term once, in the order of the layers.
+    int64_t traverse() const
+    {
+        int64_t r = 0;
+        for (auto& layer : layers) {
+            for (auto t : layer) {
+                switch (t->tag) {
+                    case term::Tag::StringLiteral:
+                        r += int64_t(term_cast<term::StringLiteral>(t)->value.size());
+                        break;
+                    case term::Tag::Application: {
+                        auto app = term_cast<term::Application>(t);
+                        r += int(app->function->tag);
+                        for (auto x : app->arguments) {
+                            r += int(x->tag);
+                        }
+                    } break;
+                    default:
+                        assert(false);
+                }
+            }
+        }
+        return r;
+    }
+    // Term has no virtual destructor, each term is destroyed as its own type, the users first.
+    void destroy(Allocator& a)
+    {
+        for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
+            for (auto t : *it) {
+                switch (t->tag) {
+                    case term::Tag::StringLiteral:
+                        alloc_bench::destroy(
+                            a, const_cast<term::StringLiteral*>(term_cast<term::StringLiteral>(t)));
+                        break;
+                    case term::Tag::Application:
+                        alloc_bench::destroy(
+                            a, const_cast<term::Application*>(term_cast<term::Application>(t)));
+                        break;
+                    default:
+                        assert(false);
+                }
+            }
+        }
+        layers.clear();
+    }
+
+private:
+    int width, depth;
+    vector<vector<TermPtr>> layers;
+};
+
+}  // namespace
+
+void run_snl_term_benchmarks(const Config& config, vector<Result>& results)
+{
+    run_with_all_allocators<SnlTermBench>("snl::Term DAG", config, results);
+}
+
+}  // namespace alloc_bench
@@ -0,0 +1,176 @@
+// Compares dispatching on bst::Expr subclasses with dynamic_cast and with the tag-switch
+// bst::visit, on a generated program.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "c2/bst.h"
+
+using namespace forrest;
+
+using hrclock = std::chrono::high_resolution_clock;
+using ddur = std::chrono::duration<double>;
+
+const int N_TOPLEVEL_DEFS = 20000;
+const int MAX_DEPTH = 8;
+const int N_REPEAT = 10;
+
+struct Generator
+{
+    std::mt19937 rng{12345};
+    int n_exprs = 0;
+
+    int uniform(int n) { return std::uniform_int_distribution<int>(0, n - 1)(rng); }
+
+    const bst::Expr* leaf(const vector<const bst::Variable*>& vars)
+    {
+        ++n_exprs;
+        switch (uniform(4)) {
+            case 0:
+                return new bst::String("s");
+            case 1:
+                return new bst::Number("1");
+            case 2:
+                if (!vars.empty()) {
+                    return vars[uniform(~vars)];
+                }
+                return new bst::ToplevelVariableName("g");
+            default:
+                return new bst::ToplevelVariableName("g");
+        }
+    }
+
+    const bst::Expr* expr(vector<const bst::Variable*>& vars, int depth)
+    {
+        if (depth >= MAX_DEPTH || uniform(5) == 0) {
+            return leaf(vars);
+        }
+        ++n_exprs;
+        switch (uniform(4)) {
+            case 0: {
+                vector<const bst::Expr*> args;
+                FOR (i, 0, < 1 + uniform(3)) {
+                    args.push_back(expr(vars, depth + 1));
+                }
+                return new bst::Fnapp(expr(vars, depth + 1), move(args));
+            }
+            case 1: {
+                vector<bst::NamedExpr> xs;
+                FOR (i, 0, < uniform(4)) {
+                    xs.emplace_back(expr(vars, depth + 1));
+                }
+                return new bst::Tuple(move(xs));
+            }
+            case 2: {
+                auto v = new bst::Variable("x");
+                vars.push_back(v);
+                auto body = expr(vars, depth + 1);
+                vars.pop_back();
+                return new bst::Fn({v}, body);
+            }
+            default: {
+                auto v = new bst::Variable("y");
+                auto value = expr(vars, depth + 1);
+                vars.push_back(v);
+                auto body = expr(vars, depth + 1);
+                vars.pop_back();
+                return new bst::Let("y", value, body);
+            }
+        }
+    }
+};
+
+// What dispatch used to cost: bst::cast and bst::try_cast were dynamic_casts.
+int count_with_dynamic_cast(const bst::Expr* e)
+{
+    using namespace bst;
+    if (dynamic_cast<const String*>(e) || dynamic_cast<const Number*>(e) ||
+        dynamic_cast<const Variable*>(e) || dynamic_cast<const ToplevelVariableName*>(e)) {
+        return 1;
+    }
+    if (auto p = dynamic_cast<const Fnapp*>(e)) {
+        int n = 1 + count_with_dynamic_cast(p->fn_to_apply);
+        for (auto a : p->args) {
+            n += count_with_dynamic_cast(a);
+        }
+        return n;
+    }
+    if (auto p = dynamic_cast<const Tuple*>(e)) {
+        int n = 1;
+        for (auto& x : p->xs) {
+            n += count_with_dynamic_cast(x.x);
+        }
+        return n;
+    }
+    if (auto p = dynamic_cast<const Fn*>(e)) {
+        return 1 + count_with_dynamic_cast(p->body);
+    }
+    if (auto p = dynamic_cast<const Let*>(e)) {
+        return 1 + count_with_dynamic_cast(p->value) + count_with_dynamic_cast(p->body);
+    }
+    if (auto p = dynamic_cast<const Def*>(e)) {
+        return 1 + count_with_dynamic_cast(p->e);
+    }
+    UL_UNREACHABLE;
+}
+
+struct Counter
+{
+    int operator()(const bst::String*) { return 1; }
+    int operator()(const bst::Number*) { return 1; }
+    int operator()(const bst::Variable*) { return 1; }
+    int operator()(const bst::ToplevelVariableName*) { return 1; }
+    int operator()(const bst::Fnapp* p)
+    {
+        int n = 1 + bst::visit(*this, p->fn_to_apply);
+        for (auto a : p->args) {
+            n += bst::visit(*this, a);
+        }
+        return n;
+    }
+    int operator()(const bst::Tuple* p)
+    {
+        int n = 1;
+        for (auto& x : p->xs) {
+            n += bst::visit(*this, x.x);
+        }
+        return n;
+    }
+    int operator()(const bst::Fn* p) { return 1 + bst::visit(*this, p->body); }
+    int operator()(const bst::Let* p)
+    {
+        return 1 + bst::visit(*this, p->value) + bst::visit(*this, p->body);
+    }
+    int operator()(const bst::Def* p) { return 1 + bst::visit(*this, p->e); }
+};
+
+template <class F>
+void test(const char* name, const vector<const bst::Expr*>& defs, F count)
+{
+    fprintf(stderr, "-- Testing: %s\n", name);
+    long n = 0;
+    auto t0 = hrclock::now();
+    FOR (i, 0, < N_REPEAT) {
+        for (auto d : defs) {
+            n += count(d);
+        }
+    }
+    auto t1 = hrclock::now();
+    fprintf(stderr, "Visited %ld nodes in %.3f ms\n", n, 1000.0 * ddur(t1 - t0).count());
+}
+
+int main()
+{
+    Generator g;
+    vector<const bst::Expr*> defs;
+    defs.reserve(N_TOPLEVEL_DEFS);
+    FOR (i, 0, < N_TOPLEVEL_DEFS) {
+        vector<const bst::Variable*> vars;
+        defs.push_back(new bst::Def("d", g.expr(vars, 0)));
+        ++g.n_exprs;
+    }
+    fprintf(stderr, "Generated %d top-level defs, %d exprs.\n", N_TOPLEVEL_DEFS, g.n_exprs);
+    test("dynamic_cast", defs, count_with_dynamic_cast);
+    test("bst::visit", defs, [](const bst::Expr* e) { return bst::visit(Counter{}, e); });
+}
@@ -0,0 +1,69 @@
+#!/bin/bash -e
+# Measures the parse and evaluation throughput of fc and c2 on programs generated by gen_fast as
+# the input grows.
+#
+# Usage: fast_bench.sh <build-dir> [<size>...]
+#
+# <build-dir> is the CMake build directory, the sizes are passed to gen_fast --target-size
+# (default: 16k 256k 4M 64M 256M). Set GEN_FAST_ARGS for more generator options, FC and C2 for
+# the compilers (default: <build-dir>/src/fc/fc and <build-dir>/src/c2/c2), an empty one is
+# skipped, a missing one is an error. Prints tab-separated lines, the phases are from --time-report:
+#   compiler  bytes  total-ms  MB/s  parse-ms  eval-ms
+# where eval is `eval` for fc and `process_ast` for c2 (which runs with --check).
+
+if [ -z "$1" ]; then
+    sed -n '5,13s/^# \{0,1\}//p' "$0"
+    exit 1
+fi
+BUILD_DIR=$1
+shift
+SIZES=${*:-16k 256k 4M 64M 256M}
+GEN_FAST=${GEN_FAST:-$BUILD_DIR/src/playground/gen_fast}
+FC=${FC-$BUILD_DIR/src/fc/fc}
+C2=${C2-$BUILD_DIR/src/c2/c2}
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+# phase_ms <report-file> <phase>, the names are in the first 32 columns of the report.
+phase_ms() {
+    awk -v phase="$2" '{
+        name = substr($0, 1, 32)
+        sub(/ +$/, "", name)
+        split(substr($0, 33), fields, " ")
+        if (name == phase) print fields[2]
+    }' "$1"
+}
+
+# run <dialect> <compiler> <parse-phase> <eval-phase> <compiler-args>...
+run() {
+    local dialect=$1 compiler=$2 parse_phase=$3 eval_phase=$4
+    shift 4
+    if [ -z "$compiler" ]; then
+        return
+    fi
+    if [ ! -x "$compiler" ]; then
+        echo "$compiler not found, build $dialect or set ${dialect^^} to empty to skip it." >&2
+        exit 1
+    fi
+    for size in $SIZES; do
+        local input=$TMP_DIR/input.fast report=$TMP_DIR/report.txt
+        "$GEN_FAST" --dialect "$dialect" --target-size "$size" $GEN_FAST_ARGS -o "$input"
+        local bytes begin end
+        bytes=$(wc -c <"$input")
+        begin=$(date +%s%N)
+        "$compiler" "$@" --time-report "$input" >/dev/null 2>"$report"
+        end=$(date +%s%N)
+        awk -v c="$dialect" -v b="$bytes" -v ns=$((end - begin)) \
+            -v p="$(phase_ms "$report" "$parse_phase")" \
+            -v e="$(phase_ms "$report" "$eval_phase")" \
+            'BEGIN {
+                printf "%s\t%d\t%.1f\t%.2f\t%s\t%s\n", c, b, ns / 1e6, b / 1e3 / ns * 1e6, p, e
+            }'
+        rm -f "$input"
+    done
+}
+
+printf "compiler\tbytes\ttotal-ms\tMB/s\tparse-ms\teval-ms\n"
+run fc "$FC" parse_fast_file_add_to_ast eval
+run c2 "$C2" "parse and build ast" process_ast --check
@@ -0,0 +1,301 @@
+// Generates syntactically valid .fast programs of a given shape for the scaling benchmarks of fc
+// and c2 (see fast_bench.sh). The output depends only on the options, including the seed.
+//
+// Each definition is a function of `--depth` nested `fn`s with 2 parameters each. The innermost
+// body is a tuple of `--width` items: parameters, numbers, string literals and `--fan-out` calls
+// to earlier definitions. The calls pass a single argument (fc) or the arguments of the outermost
+// `fn` (c2, which doesn't curry) so with `--depth` > 1 they evaluate to closures, evaluating a
+// definition doesn't evaluate its callees and the evaluation time stays linear in the size of the
+// program. The program ends with calling all definitions (fc) or with a `main` function calling
+// them (c2, which accepts only definitions at the top level), with the arguments of all nested
+// `fn`s.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const char* const USAGE_TEXT =
+    R"~~~~(Usage: %s [options]
+
+--dialect fc|c2        syntax of fc or c2 (default: fc)
+--defs <n>             number of top-level definitions (default: 100)
+--target-size <bytes>  emit definitions until the output reaches this size instead of --defs,
+                       k and M suffixes are accepted
+--depth <n>            nesting depth of `fn`s in a definition (default: 2)
+--width <n>            number of items of the tuple in the innermost body (default: 8)
+--string-size <n>      length of the string literals (default: 16)
+--fan-out <n>          calls to earlier definitions in a body (default: 2)
+--seed <n>             seed of the random choices (default: 1)
+-o <filename>          output file (default: stdout)
+)~~~~";
+
+enum class Dialect
+{
+    FC,
+    C2
+};
+
+struct Options
+{
+    Dialect dialect = Dialect::FC;
+    long defs = 100;
+    long long target_size = 0;
+    int depth = 2;
+    int width = 8;
+    int string_size = 16;
+    int fan_out = 2;
+    unsigned seed = 1;
+    string output;
+};
+
+const int N_PARS_PER_FN = 2;
+
+class Generator
+{
+public:
+    Generator(const Options& o, FILE* f) : o(o), f(f), rng(o.seed) {}
+
+    void generate()
+    {
+        long n_defs = 0;
+        while (o.target_size > 0 ? bytes_written < o.target_size : n_defs < o.defs) {
+            def(n_defs++);
+        }
+        entry_point(n_defs);
+    }
+
+private:
+    const Options& o;
+    FILE* const f;
+    std::mt19937 rng;
+    long long bytes_written = 0;
+
+    bool fc() const { return o.dialect == Dialect::FC; }
+
+    // Not std::uniform_int_distribution, its results differ between standard libraries.
+    long uniform(long n) { return long(rng() % uint64_t(n)); }
+
+    void write(const string& s)
+    {
+        fwrite(s.data(), 1, s.size(), f);
+        bytes_written += s.size();
+    }
+
+    // A symbol (fc) or a name in a binding position (c2).
+    string name(const string& s) const { return fc() ? "`" + s : "\"" + s + "\""; }
+    // Opening and closing a function application. The c2 parser reads ')' as part of a symbol,
+    // the closing character is preceded by a space.
+    const char* open_apply() const { return fc() ? "{" : "("; }
+    const char* close_apply() const { return fc() ? "}" : " )"; }
+    const char* open_tuple() const { return fc() ? "(" : "["; }
+    const char* close_tuple() const { return fc() ? ")" : "]"; }
+
+    static string def_name(long i) { return "f" + std::to_string(i); }
+    static string par_name(int level, int j)
+    {
+        return "p" + std::to_string(level) + "_" + std::to_string(j);
+    }
+
+    void def(long i)
+    {
+        write(open_apply());
+        write("def " + name(def_name(i)) + " ");
+        fn(i, 0);
+        write(close_apply());
+        write("\n");
+    }
+
+    // {fn (`a `b) `body} in fc, (fn ["a" "b"] body) in c2.
+    void fn(long i, int level)
+    {
+        write(open_apply());
+        write("fn ");
+        write(open_tuple());
+        for (int j = 0; j < N_PARS_PER_FN; ++j) {
+            write((j > 0 ? " " : "") + name(par_name(level, j)));
+        }
+        write(close_tuple());
+        write(fc() ? " `" : " ");
+        if (level + 1 < o.depth) {
+            fn(i, level + 1);
+        } else {
+            body(i);
+        }
+        write(close_apply());
+    }
+
+    void body(long i)
+    {
+        // The positions of the calls among the items.
+        vector<char> is_call(std::max(o.width, i > 0 ? o.fan_out : 0), false);
+        if (i > 0) {
+            for (int k = 0; k < o.fan_out; ++k) {
+                is_call[k] = true;
+            }
+            for (size_t k = is_call.size() - 1; k > 0; --k) {
+                std::swap(is_call[k], is_call[uniform(long(k) + 1)]);
+            }
+        }
+        write(open_tuple());
+        for (size_t k = 0; k < is_call.size(); ++k) {
+            if (k > 0) {
+                write(" ");
+            }
+            if (is_call[k]) {
+                write(open_apply());
+                write(def_name(uniform(i)));
+                for (int j = 0; j < (fc() ? 1 : N_PARS_PER_FN); ++j) {
+                    write(" " + parameter());
+                }
+                write(close_apply());
+            } else {
+                item();
+            }
+        }
+        write(close_tuple());
+    }
+
+    string parameter() { return par_name(uniform(o.depth), uniform(N_PARS_PER_FN)); }
+
+    void item()
+    {
+        switch (uniform(3)) {
+            case 0:
+                write(parameter());
+                break;
+            case 1:
+                write(std::to_string(uniform(1000000)));
+                break;
+            default: {
+                string s(o.string_size + 2, '"');
+                for (int k = 1; k <= o.string_size; ++k) {
+                    s[k] = char('a' + uniform(26));
+                }
+                write(s);
+            }
+        }
+    }
+
+    // Calls each definition with all the arguments of its nested functions: at once in fc, one
+    // application per `fn` in c2, like ((f 0 1 ) 2 3 ).
+    void entry_point(long n_defs)
+    {
+        if (fc()) {
+            string args;
+            for (int k = 0; k < o.depth * N_PARS_PER_FN; ++k) {
+                args += " " + std::to_string(k);
+            }
+            for (long i = 0; i < n_defs; ++i) {
+                write("{" + def_name(i) + args + "}\n");
+            }
+            return;
+        }
+        string opening(o.depth, '(');
+        string args;
+        for (int level = 0; level < o.depth; ++level) {
+            for (int j = 0; j < N_PARS_PER_FN; ++j) {
+                args += " " + std::to_string(level * N_PARS_PER_FN + j);
+            }
+            args += " )";
+        }
+        write("(def \"main\" (fn [\"u\"] [");
+        for (long i = 0; i < n_defs; ++i) {
+            write("\n    " + opening + def_name(i) + args);
+        }
+        write("] ) )\n");
+    }
+};
+
+// Accepts k and M suffixes.
+bool parse_size(const char* s, long long& x)
+{
+    char* end;
+    x = strtoll(s, &end, 10);
+    if (*end == 'k') {
+        x *= 1024;
+        ++end;
+    } else if (*end == 'M') {
+        x *= 1024 * 1024;
+        ++end;
+    }
+    return end != s && *end == 0 && x >= 0;
+}
+
+bool parse_command_line(int argc, const char* argv[], Options& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto a = argv[i];
+        if (i + 1 == argc) {
+            return false;
+        }
+        auto v = argv[++i];
+        long long x = 0;
+        if (strcmp(a, "--dialect") == 0) {
+            if (strcmp(v, "fc") == 0) {
+                o.dialect = Dialect::FC;
+            } else if (strcmp(v, "c2") == 0) {
+                o.dialect = Dialect::C2;
+            } else {
+                return false;
+            }
+        } else if (strcmp(a, "-o") == 0) {
+            o.output = v;
+        } else if (!parse_size(v, x)) {
+            return false;
+        } else if (strcmp(a, "--defs") == 0) {
+            o.defs = long(x);
+        } else if (strcmp(a, "--target-size") == 0) {
+            o.target_size = x;
+        } else if (strcmp(a, "--depth") == 0 && x >= 1) {
+            o.depth = int(x);
+        } else if (strcmp(a, "--width") == 0 && x >= 1) {
+            o.width = int(x);
+        } else if (strcmp(a, "--string-size") == 0) {
+            o.string_size = int(x);
+        } else if (strcmp(a, "--fan-out") == 0) {
+            o.fan_out = int(x);
+        } else if (strcmp(a, "--seed") == 0) {
+            o.seed = unsigned(x);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    Options o;
+    if (!parse_command_line(argc, argv, o)) {
+        fprintf(stderr, USAGE_TEXT, argv[0]);
+        return EXIT_FAILURE;
+    }
+    auto f = o.output.empty() ? stdout : fopen(o.output.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Can't open %s for writing.\n", o.output.c_str());
+        return EXIT_FAILURE;
+    }
+    Generator(o, f).generate();
+    bool ok = !ferror(f);
+    if (f != stdout) {
+        ok = fclose(f) == 0 && ok;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error writing %s.\n", o.output.empty() ? "stdout" : o.output.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
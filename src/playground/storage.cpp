@@ -10,6 +10,8 @@
 #include <utility>
 #include <vector>
 
+#include "util/alloc_tracking.h"
+
 using std::array;
 using std::deque;
 using std::make_unique;
@@ -28,41 +30,10 @@ const int TOTAL_LEVELS = 12;
 struct Counters
 {
     int nodes = 0;
-    size_t alloc_size = 0;
-    int allocs = 0;
-    int frees = 0;
 };
 
 Counters counters;
 
-void* operator new(size_t size)
-{
-    ++counters.allocs;
-    counters.alloc_size += size;
-    void* p = malloc(size);
-    return p;
-}
-
-void* my_new(size_t size)
-{
-    ++counters.allocs;
-    counters.alloc_size += size;
-    void* p = malloc(size);
-    return p;
-}
-
-void operator delete(void* p) noexcept
-{
-    ++counters.frees;
-    free(p);
-}
-
-void my_delete(void* p) noexcept
-{
-    ++counters.frees;
-    free(p);
-}
-
 template <class T>
 struct aligned_item_size
 {
@@ -119,7 +90,7 @@ public:
     {
         if (size <= MAX_SMALL_BLOCK_SIZE) {
             if (!active_page_free_begin) {
-                active_page_free_begin = my_new(BLOCK_PAGE_SIZE);
+                active_page_free_begin = ::operator new(BLOCK_PAGE_SIZE);
                 active_page_free_bytes = BLOCK_PAGE_SIZE;
                 pages.push_back(active_page_free_begin);
             }
@@ -141,7 +112,7 @@ public:
     ~Allocator()
     {
         for (auto p : pages)
-            my_delete(p);
+            ::operator delete(p);
     }
 
     template <class T, class... Args>
@@ -275,6 +246,7 @@ template <class Allocator, class Node>
 void test(const char* name)
 {
     counters = Counters{};
+    auto allocations_at_start = forrest::total_allocation_counters();
     fprintf(stderr, "-- Testing: %s\n", name);
     time_point t0, t1;
     duration dur_build, dur_traverse, dur_dtor;
@@ -299,8 +271,11 @@ void test(const char* name)
     fprintf(stderr, "Destruction: %.3f ms\n", 1000.0 * ddur(dur_dtor).count());
     fprintf(stderr, "Total time: %.3f ms\n",
             1000.0 * ddur(dur_build + dur_traverse + dur_dtor).count());
-    fprintf(stderr, "%d allocations (%.3f MB), %d frees.\n", counters.allocs,
-            counters.alloc_size / 1e6, counters.frees);
+    auto allocations = forrest::total_allocation_counters();
+    fprintf(stderr, "%d allocations (%.3f MB), %d frees.\n",
+            int(allocations.allocs - allocations_at_start.allocs),
+            (allocations.bytes - allocations_at_start.bytes) / 1e6,
+            int(allocations.frees - allocations_at_start.frees));
 }
 
 int main()
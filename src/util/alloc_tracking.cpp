@@ -0,0 +1,211 @@
+#include "alloc_tracking.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef FORREST_ALLOC_TRACKING
+#error "alloc_tracking.cpp needs FORREST_ALLOC_TRACKING, link the alloc_tracking library."
+#endif
+
+namespace forrest {
+
+namespace {
+
+// The counters can't allocate, so the slots are a static array. Threads after the first
+// MAX_THREADS share the last slot, that's why the counters are atomic.
+const int MAX_THREADS = 256;
+
+struct alignas(64) ThreadSlot
+{
+    std::atomic<uint64_t> allocs;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> histogram[ALLOCATION_SIZE_BUCKETS];
+};
+
+ThreadSlot g_slots[MAX_THREADS];
+std::atomic<int> g_n_slots{0};
+
+thread_local ThreadSlot* t_slot = nullptr;
+
+ThreadSlot& this_thread_slot()
+{
+    if (!t_slot) {
+        int i = g_n_slots.fetch_add(1, std::memory_order_relaxed);
+        t_slot = &g_slots[i < MAX_THREADS ? i : MAX_THREADS - 1];
+    }
+    return *t_slot;
+}
+
+int size_bucket(size_t size)
+{
+    int b = 0;
+    while (size > 0 && b + 1 < ALLOCATION_SIZE_BUCKETS) {
+        size >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+void count_alloc(size_t size)
+{
+    auto& s = this_thread_slot();
+    s.allocs.fetch_add(1, std::memory_order_relaxed);
+    s.bytes.fetch_add(size, std::memory_order_relaxed);
+    s.histogram[size_bucket(size)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void count_free(void* p)
+{
+    if (p) {
+        this_thread_slot().frees.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+AllocationCounters counters_of(const ThreadSlot& s)
+{
+    return AllocationCounters{s.allocs.load(std::memory_order_relaxed),
+                              s.frees.load(std::memory_order_relaxed),
+                              s.bytes.load(std::memory_order_relaxed)};
+}
+
+void* counted_malloc(size_t size)
+{
+    count_alloc(size);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* counted_aligned_alloc(size_t size, std::align_val_t al)
+{
+    count_alloc(size);
+    auto alignment = static_cast<size_t>(al);
+    // aligned_alloc needs a multiple of the alignment.
+    if (void* p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void counted_free(void* p)
+{
+    count_free(p);
+    free(p);
+}
+
+}  // namespace
+
+AllocationCounters this_thread_allocation_counters()
+{
+    return counters_of(this_thread_slot());
+}
+
+AllocationCounters total_allocation_counters()
+{
+    AllocationCounters r;
+    int n = std::min(g_n_slots.load(std::memory_order_relaxed), MAX_THREADS);
+    for (int i = 0; i < n; ++i) {
+        auto c = counters_of(g_slots[i]);
+        r.allocs += c.allocs;
+        r.frees += c.frees;
+        r.bytes += c.bytes;
+    }
+    return r;
+}
+
+void print_allocation_report(FILE* f)
+{
+    auto total = total_allocation_counters();
+    fprintf(f, "%llu allocations (%.3f MB), %llu frees.\n", (unsigned long long)total.allocs,
+            total.bytes / 1e6, (unsigned long long)total.frees);
+    uint64_t histogram[ALLOCATION_SIZE_BUCKETS] = {};
+    int n = std::min(g_n_slots.load(std::memory_order_relaxed), MAX_THREADS);
+    for (int i = 0; i < n; ++i) {
+        for (int b = 0; b < ALLOCATION_SIZE_BUCKETS; ++b) {
+            histogram[b] += g_slots[i].histogram[b].load(std::memory_order_relaxed);
+        }
+    }
+    fprintf(f, "%-24s %12s\n", "allocation size", "count");
+    for (int b = 0; b < ALLOCATION_SIZE_BUCKETS; ++b) {
+        if (histogram[b] == 0) {
+            continue;
+        }
+        char range[32];
+        if (b == 0) {
+            snprintf(range, sizeof(range), "0");
+        } else {
+            snprintf(range, sizeof(range), "%llu..%llu", 1ull << (b - 1), (1ull << b) - 1);
+        }
+        fprintf(f, "%-24s %12llu\n", range, (unsigned long long)histogram[b]);
+    }
+}
+
+}  // namespace forrest
+
+// The nothrow variants of the standard library call these. The sized deletes are replaced too,
+// the compiler calls them directly (-fsized-deallocation is the default since C++14) and whether
+// the library versions forward to the unsized ones is up to the library.
+
+void* operator new(size_t size)
+{
+    return forrest::counted_malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return forrest::counted_malloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t al)
+{
+    return forrest::counted_aligned_alloc(size, al);
+}
+
+void* operator new[](size_t size, std::align_val_t al)
+{
+    return forrest::counted_aligned_alloc(size, al);
+}
+
+void operator delete(void* p) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    forrest::counted_free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+    forrest::counted_free(p);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace forrest {
+
+// Counts of the global operator new/delete calls. The counting operators are in the
+// alloc_tracking library, which defines FORREST_ALLOC_TRACKING for the targets linking it (see
+// the FORREST_ALLOC_TRACKING CMake option). Without it the functions below return zeros and cost
+// nothing.
+//
+// Each thread counts into its own slot, the totals are summed over the slots and include the
+// threads which have exited.
+
+struct AllocationCounters
+{
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;  // Requested, the total of the allocations.
+};
+
+// Bucket 0 counts the zero-sized allocations, bucket i > 0 the sizes in [2^(i-1), 2^i).
+const int ALLOCATION_SIZE_BUCKETS = 48;
+
+#if FORREST_ALLOC_TRACKING
+
+AllocationCounters this_thread_allocation_counters();
+AllocationCounters total_allocation_counters();
+// Totals and the histogram of the allocation sizes over all threads.
+void print_allocation_report(FILE* f);
+
+#else
+
+inline AllocationCounters this_thread_allocation_counters()
+{
+    return {};
+}
+inline AllocationCounters total_allocation_counters()
+{
+    return {};
+}
+inline void print_allocation_report(FILE*) {}
+
+#endif
+
+}  // namespace forrest
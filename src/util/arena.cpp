@@ -1,4 +1,168 @@
-
 #include "arena.h"
 
-namespace forrest {}
\ No newline at end of file
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define FORREST_ARENA_HAS_MMAP 1
+#else
+#define FORREST_ARENA_HAS_MMAP 0
+#endif
+
+namespace forrest {
+
+static_assert(Arena::MMAP_CHUNK_SIZE % Arena::PAGE_SIZE == 0);
+
+Arena::Arena(PageSource page_source)
+    : page_source(FORREST_ARENA_HAS_MMAP ? page_source : PageSource::Heap)
+{}
+
+Arena::~Arena()
+{
+    clear();
+    if (page_source == PageSource::Heap) {
+        for (auto p : pages) {
+            operator delete(p, std::align_val_t(PAGE_ALIGNMENT));
+        }
+    }
+#if FORREST_ARENA_HAS_MMAP
+    for (auto p : mmap_chunks) {
+        munmap(p, MMAP_CHUNK_SIZE);
+    }
+#endif
+}
+
+Arena& Arena::thread_local_instance()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+void* Arena::new_page()
+{
+    if (page_source == PageSource::Heap) {
+        return operator new(PAGE_SIZE, std::align_val_t(PAGE_ALIGNMENT));
+    }
+#if FORREST_ARENA_HAS_MMAP
+    if (mmap_chunk_next_page == mmap_chunk_end) {
+        // Map twice the size so a MMAP_CHUNK_SIZE-aligned range can be cut out of it, only an
+        // aligned range can be backed by a huge page.
+        size_t map_size = 2 * MMAP_CHUNK_SIZE;
+        auto p = (char*)mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Arena: mmap of %d bytes failed.\n", (int)map_size);
+            std::terminate();
+        }
+        auto q = (char*)(((uintptr_t)p + MMAP_CHUNK_SIZE - 1) & ~(uintptr_t)(MMAP_CHUNK_SIZE - 1));
+        if (q > p) {
+            munmap(p, q - p);
+        }
+        auto q_end = q + MMAP_CHUNK_SIZE;
+        if (p + map_size > q_end) {
+            munmap(q_end, p + map_size - q_end);
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(q, MMAP_CHUNK_SIZE, MADV_HUGEPAGE);
+#endif
+        mmap_chunks.push_back(q);
+        mmap_chunk_next_page = q;
+        mmap_chunk_end = q_end;
+    }
+    auto page = mmap_chunk_next_page;
+    mmap_chunk_next_page += PAGE_SIZE;
+    return page;
+#else
+    assert(false);
+    return nullptr;
+#endif
+}
+
+void Arena::activate_next_page()
+{
+    if (n_used_pages == pages.size()) {
+        // Free list is empty.
+        pages.push_back(new_page());
+    }
+    active_page_first_free_byte = pages[n_used_pages++];
+    active_page_bytes_left = PAGE_SIZE;
+}
+
+void* Arena::allocate_large_block(size_t size, size_t alignment)
+{
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    auto p = operator new(size, std::align_val_t(alignment));
+    large_blocks.push_back(LargeBlock{p, size, alignment});
+    bytes_used += size;
+    return p;
+}
+
+void Arena::rewind(const Mark& m)
+{
+    assert(m.n_used_pages <= n_used_pages && m.bytes_used <= bytes_used &&
+           m.n_large_blocks <= large_blocks.size());
+    n_used_pages = m.n_used_pages;
+    if (n_used_pages > 0 && m.active_page_bytes_left > 0) {
+        active_page_bytes_left = m.active_page_bytes_left;
+        active_page_first_free_byte =
+            (char*)pages[n_used_pages - 1] + (PAGE_SIZE - active_page_bytes_left);
+    } else {
+        // The marked page was full (or there was none), next allocation takes a new one.
+        active_page_first_free_byte = nullptr;
+        active_page_bytes_left = 0;
+    }
+    for (size_t i = m.n_large_blocks; i < large_blocks.size(); ++i) {
+        operator delete(large_blocks[i].p, std::align_val_t(large_blocks[i].alignment));
+    }
+    large_blocks.resize(m.n_large_blocks);
+    bytes_used = m.bytes_used;
+    bytes_wasted_to_alignment = m.bytes_wasted_to_alignment;
+    bytes_wasted_at_page_ends = m.bytes_wasted_at_page_ends;
+}
+
+bool Arena::allocated_since(const Mark& m, const void* p) const
+{
+    auto in = [p](const void* first, size_t size) {
+        return (const char*)first <= (const char*)p && (const char*)p < (const char*)first + size;
+    };
+    if (m.n_used_pages > 0 && m.active_page_bytes_left > 0) {
+        // Rest of the page which was active at the mark.
+        auto page_end = (const char*)pages[m.n_used_pages - 1] + PAGE_SIZE;
+        if (in(page_end - m.active_page_bytes_left, m.active_page_bytes_left)) {
+            return true;
+        }
+    }
+    for (size_t i = m.n_used_pages; i < n_used_pages; ++i) {
+        if (in(pages[i], PAGE_SIZE)) {
+            return true;
+        }
+    }
+    for (size_t i = m.n_large_blocks; i < large_blocks.size(); ++i) {
+        if (in(large_blocks[i].p, large_blocks[i].size)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Arena::release_free_pages()
+{
+    if (page_source == PageSource::Heap) {
+        for (size_t i = n_used_pages; i < pages.size(); ++i) {
+            operator delete(pages[i], std::align_val_t(PAGE_ALIGNMENT));
+        }
+        pages.resize(n_used_pages);
+        return;
+    }
+#if FORREST_ARENA_HAS_MMAP
+    for (size_t i = n_used_pages; i < pages.size(); ++i) {
+        madvise(pages[i], PAGE_SIZE, MADV_DONTNEED);
+    }
+#endif
+}
+
+}  // namespace forrest
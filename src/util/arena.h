@@ -1,45 +1,131 @@
 #pragma once
 
-#include <deque>
-#include <type_traits>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
 
 namespace forrest {
-using std::deque;
+using std::vector;
 
+// Bump allocator. Objects allocated here are never destructed, the memory is released in bulk when
+// the arena is destroyed or rewound to an earlier mark.
+// Blocks larger than MAX_SMALL_BLOCK_SIZE get their own chunk which is freed with the arena.
 class Arena
 {
+public:
     static const size_t PAGE_SIZE = 65536;
+    static const size_t PAGE_ALIGNMENT = 1024;
     static const size_t MAX_SMALL_BLOCK_SIZE = 8192;
-    using Page = std::aligned_storage<PAGE_SIZE, 1024>::type;
-    deque<Page> pages;
+    // Pages are mapped in runs of this size, so with PageSource::Mmap they can be backed by one
+    // transparent huge page.
+    static const size_t MMAP_CHUNK_SIZE = 2 * 1024 * 1024;
+
+    enum class PageSource
+    {
+        Heap,
+        Mmap  // Anonymous mmap, advised to use transparent huge pages where supported.
+    };
+
+    struct Stats
+    {
+        size_t pages = 0;       // All pages owned by the arena.
+        size_t used_pages = 0;  // Pages up to and including the active one.
+        size_t bytes_used = 0;  // Sum of the requested sizes.
+        size_t bytes_wasted_to_alignment = 0;
+        // Rest of the pages which were retired because the next block didn't fit.
+        size_t bytes_wasted_at_page_ends = 0;
+        size_t large_blocks = 0;  // Included in bytes_used.
+    };
+
+    // Position in the arena, everything allocated after it can be released with rewind().
+    struct Mark
+    {
+        size_t n_used_pages;
+        size_t active_page_bytes_left;
+        size_t bytes_used;
+        size_t bytes_wasted_to_alignment;
+        size_t bytes_wasted_at_page_ends;
+        size_t n_large_blocks;
+    };
+
+    // Rewinds the arena to the state it was in at construction.
+    class Scope
+    {
+        Arena& arena;
+        const Mark m;
+
+    public:
+        explicit Scope(Arena& arena) : arena(arena), m(arena.mark()) {}
+        Scope(const Scope&) = delete;
+        void operator=(const Scope&) = delete;
+        ~Scope() { arena.rewind(m); }
+    };
+
+private:
+    struct LargeBlock
+    {
+        void* p;
+        size_t size;
+        size_t alignment;
+    };
+
+    const PageSource page_source;
+    // Pages [0, n_used_pages) hold live allocations, the rest is the free list of recycled pages
+    // which will be reused before allocating a new one.
+    vector<void*> pages;
+    size_t n_used_pages = 0;
     void* active_page_first_free_byte = nullptr;
     size_t active_page_bytes_left = 0;
 
+    size_t bytes_used = 0;
+    size_t bytes_wasted_to_alignment = 0;
+    size_t bytes_wasted_at_page_ends = 0;
+
+    vector<LargeBlock> large_blocks;
+    vector<void*> mmap_chunks;  // PageSource::Mmap only.
+    char* mmap_chunk_next_page = nullptr;
+    char* mmap_chunk_end = nullptr;
+
+    void activate_next_page();
+    void* new_page();
+    void* allocate_large_block(size_t size, size_t alignment);
+
 public:
+    explicit Arena(PageSource page_source = PageSource::Heap);
+    Arena(const Arena&) = delete;
+    void operator=(const Arena&) = delete;
+    ~Arena();
+
+    // Arena of the calling thread, for workers which need scratch memory without synchronization.
+    // Callers release their allocations with a Scope, the pages are kept for the thread's next use.
+    static Arena& thread_local_instance();
+
     void* allocate_block(size_t size, size_t alignment)
     {
         if (size <= MAX_SMALL_BLOCK_SIZE) {
             if (!active_page_first_free_byte) {
-                // Need a new page.
-                pages.emplace_back();
-                active_page_first_free_byte = &pages.back();
-                active_page_bytes_left = PAGE_SIZE;
+                activate_next_page();
             }
+            auto bytes_left_before_align = active_page_bytes_left;
             if (std::align(alignment, size, active_page_first_free_byte, active_page_bytes_left)) {
                 // Allocate from active page.
                 auto result = active_page_first_free_byte;
                 active_page_first_free_byte = (char*)active_page_first_free_byte + size;
                 active_page_bytes_left -= size;
+                bytes_used += size;
+                bytes_wasted_to_alignment +=
+                    bytes_left_before_align - active_page_bytes_left - size;
                 return result;
             } else {
                 // No room in active page, inactivate and retry.
+                bytes_wasted_at_page_ends += active_page_bytes_left;
                 active_page_first_free_byte = nullptr;
                 active_page_bytes_left = 0;
                 return allocate_block(size, alignment);
             }
         }
-        fprintf(stderr, "Allocating more then %d is not implemented.\n", (int)MAX_SMALL_BLOCK_SIZE);
-        std::terminate();
+        return allocate_large_block(size, alignment);
     }
 
     // Allocate and placement-new.
@@ -49,5 +135,33 @@ public:
         void* p = allocate_block(sizeof(T), alignof(T));
         return new (p) T(std::forward<Args>(args)...);
     }
+
+    Mark mark() const
+    {
+        return Mark{n_used_pages, active_page_first_free_byte ? active_page_bytes_left : 0,
+                    bytes_used, bytes_wasted_to_alignment, bytes_wasted_at_page_ends,
+                    large_blocks.size()};
+    }
+    // Release everything allocated since `m`. O(1) for pages (the ones after the marked page are
+    // kept on the free list), large blocks allocated since the mark are freed one by one.
+    void rewind(const Mark& m);
+    // Whether `p` points into a block allocated since `m`. O(number of pages and large blocks
+    // allocated since `m`).
+    bool allocated_since(const Mark& m, const void* p) const;
+    // Rewind to the empty state.
+    void clear() { rewind(Mark{0, 0, 0, 0, 0, 0}); }
+    // Give the pages on the free list back to the system. With PageSource::Mmap the address range
+    // is kept (the pages stay on the free list), only the physical memory is released.
+    void release_free_pages();
+
+    Stats stats() const
+    {
+        return Stats{pages.size(),
+                     n_used_pages,
+                     bytes_used,
+                     bytes_wasted_to_alignment,
+                     bytes_wasted_at_page_ends,
+                     large_blocks.size()};
+    }
 };
 }  // namespace forrest
@@ -19,6 +19,20 @@ either<string, FileReader> FileReader::new_(string filename)
                          errno == 0 ? "Unknown error" : strerror(errno));
 }
 
+either<string, FileReader> FileReader::new_from_memory(const string& content, string filename)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    FILE* f = fmemopen(const_cast<char*>(content.data()), content.size(), "rb");
+    if (f)
+        return FileReader(f, move(filename));
+    else
+        return StrFormat("Can't read %s from memory: %s.", filename.c_str(),
+                         errno == 0 ? "Unknown error" : strerror(errno));
+#else
+    return StrFormat("Can't read %s from memory on this platform.", filename.c_str());
+#endif
+}
+
 FileReader::~FileReader()
 {
     if (f) {
@@ -73,8 +87,8 @@ void FileReader::refill_read_buf()
         const auto nuc = n_unread_chars();
         if (nuc >= UTF8_BUF_MIN_SIZE)
             return;
-        // Move unread part back to buffer start.
-        if (nuc > 0) {
+        // Move unread part back to buffer start, also if it's empty or the buffer would overflow.
+        {
             const Utf8Char* a = next_utf8_to_read;
             const Utf8Char* b = utf8_buf_end;
             std::copy(a, b, utf8_buf->data());
@@ -100,6 +114,7 @@ void FileReader::refill_read_buf()
                 set_input_error("Can't read file.");
                 return;
             } else if (feof(f)) {
+                fclose(f);
                 f = nullptr;
             } else {
                 set_input_error("No bytes received while reading file.");
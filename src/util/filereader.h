@@ -40,6 +40,9 @@ class FileReader
 
 public:
     static either<string, FileReader> new_(string filename);
+    // Reads `content` instead of the file, `filename` is only used in the messages. `content` must
+    // outlive the FileReader.
+    static either<string, FileReader> new_from_memory(const string& content, string filename);
 
     // fow now, only move ctor allowed (add move assignment if needed)
     FileReader(const FileReader&) = delete;
@@ -0,0 +1,227 @@
+#include "timing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace forrest {
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+TimingGlobals g_timing;
+
+namespace {
+
+struct TimingEvent
+{
+    const char* name;
+    int64_t begin_ns;
+    int64_t end_ns;
+    AllocationCounters allocations;
+};
+
+struct ThreadEvents
+{
+    int tid;  // In the order of the first event, the main thread is usually 0.
+    vector<TimingEvent> events;
+    vector<const char*> active_scopes;
+};
+
+std::mutex g_threads_mutex;
+vector<unique_ptr<ThreadEvents>> g_threads;
+int64_t g_start_ns = 0;
+
+thread_local ThreadEvents* t_events = nullptr;
+
+ThreadEvents& this_thread_events()
+{
+    if (!t_events) {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        g_threads.push_back(std::make_unique<ThreadEvents>());
+        g_threads.back()->tid = int(g_threads.size()) - 1;
+        t_events = g_threads.back().get();
+    }
+    return *t_events;
+}
+
+string json_string(const char* s)
+{
+    string r = "\"";
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            r += '\\';
+            r += char(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            r += buf;
+        } else {
+            r += char(c);
+        }
+    }
+    return r + '"';
+}
+
+}  // namespace
+
+void enable_timing()
+{
+    std::lock_guard<std::mutex> lock(g_threads_mutex);
+    for (auto& t : g_threads) {
+        t->events.clear();
+    }
+    g_start_ns = timing_now_ns();
+    g_timing.enabled = true;
+}
+
+void disable_timing()
+{
+    g_timing.enabled = false;
+}
+
+int64_t timing_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool enter_timing_scope(const char* name)
+{
+    auto& t = this_thread_events();
+    for (auto s : t.active_scopes) {
+        if (s == name || strcmp(s, name) == 0) {
+            return false;
+        }
+    }
+    t.active_scopes.push_back(name);
+    return true;
+}
+
+void exit_timing_scope()
+{
+    auto& t = this_thread_events();
+    assert(!t.active_scopes.empty());
+    t.active_scopes.pop_back();
+}
+
+void record_timing_event(const char* name,
+                         int64_t begin_ns,
+                         int64_t end_ns,
+                         const AllocationCounters& allocations)
+{
+    this_thread_events().events.push_back(TimingEvent{name, begin_ns, end_ns, allocations});
+}
+
+void print_time_report(FILE* f)
+{
+    struct Phase
+    {
+        const char* name;
+        int count = 0;
+        int64_t total_ns = 0;
+        int64_t max_ns = 0;
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+    };
+    // Names are compared by content, the same literal may have different addresses in different
+    // translation units.
+    std::unordered_map<string, Phase> phases;
+    {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        for (auto& t : g_threads) {
+            for (auto& e : t->events) {
+                auto& p = phases[e.name];
+                p.name = e.name;
+                ++p.count;
+                auto d = e.end_ns - e.begin_ns;
+                p.total_ns += d;
+                p.max_ns = std::max(p.max_ns, d);
+                p.allocs += e.allocations.allocs;
+                p.bytes += e.allocations.bytes;
+            }
+        }
+    }
+    vector<Phase> sorted;
+    for (auto& kv : phases) {
+        sorted.push_back(kv.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Phase& x, const Phase& y) {
+        return x.total_ns > y.total_ns || (x.total_ns == y.total_ns && strcmp(x.name, y.name) < 0);
+    });
+#if FORREST_ALLOC_TRACKING
+    fprintf(f, "%-32s %8s %12s %12s %12s %12s %12s\n", "phase", "count", "total ms", "avg ms",
+            "max ms", "allocs", "alloc MB");
+    for (auto& p : sorted) {
+        fprintf(f, "%-32s %8d %12.3f %12.3f %12.3f %12llu %12.3f\n", p.name, p.count,
+                p.total_ns / 1e6, p.total_ns / 1e6 / p.count, p.max_ns / 1e6,
+                (unsigned long long)p.allocs, p.bytes / 1e6);
+    }
+    print_allocation_report(f);
+#else
+    fprintf(f, "%-32s %8s %12s %12s %12s\n", "phase", "count", "total ms", "avg ms", "max ms");
+    for (auto& p : sorted) {
+        fprintf(f, "%-32s %8d %12.3f %12.3f %12.3f\n", p.name, p.count, p.total_ns / 1e6,
+                p.total_ns / 1e6 / p.count, p.max_ns / 1e6);
+    }
+#endif
+}
+
+bool write_chrome_trace(const string& path)
+{
+    auto f = fopen(path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Can't open %s for writing.\n", path.c_str());
+        return false;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&first]() {
+        auto s = first ? "" : ",\n";
+        first = false;
+        return s;
+    };
+    {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        for (auto& t : g_threads) {
+            if (t->events.empty()) {
+                continue;
+            }
+            fprintf(f,
+                    "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s %d\"}}",
+                    separator(), t->tid, t->tid == 0 ? "main" : "worker", t->tid);
+            // Complete ("X") events in microseconds.
+            for (auto& e : t->events) {
+                fprintf(f,
+                        "%s{\"name\":%s,\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                        "\"dur\":%.3f",
+                        separator(), json_string(e.name).c_str(), t->tid,
+                        (e.begin_ns - g_start_ns) / 1e3, (e.end_ns - e.begin_ns) / 1e3);
+#if FORREST_ALLOC_TRACKING
+                fprintf(f, ",\"args\":{\"allocs\":%llu,\"alloc_bytes\":%llu}",
+                        (unsigned long long)e.allocations.allocs,
+                        (unsigned long long)e.allocations.bytes);
+#endif
+                fprintf(f, "}");
+            }
+        }
+    }
+    fprintf(f, "\n]}\n");
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Error writing %s.\n", path.c_str());
+    }
+    return ok;
+}
+
+}  // namespace forrest
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "alloc_tracking.h"
+
+namespace forrest {
+
+// Scoped phase timers. Disabled by default, then a timer is a single test of a global flag.
+// Defining FORREST_DISABLE_TIMING removes them from the build.
+//
+// Each thread records its events into its own buffer, so timers on worker threads don't contend
+// and get their own track in the trace. A timer inside a timer of the same name on the same thread
+// (recursion) is not recorded, so the phases of recursive functions are not counted more than
+// once. With allocation tracking (alloc_tracking.h) the events
+// also have the number and size of the allocations made by the thread during the phase.
+
+struct TimingGlobals
+{
+    bool enabled = false;
+};
+
+extern TimingGlobals g_timing;
+
+// Starts recording, drops the events recorded so far. Timestamps in the trace are relative to this
+// call.
+void enable_timing();
+void disable_timing();
+
+int64_t timing_now_ns();
+// Returns false if a timer of the same name is active on this thread, otherwise it's active until
+// exit_timing_scope().
+bool enter_timing_scope(const char* name);
+void exit_timing_scope();
+// `name` must outlive the reports, usually a string literal.
+void record_timing_event(const char* name,
+                         int64_t begin_ns,
+                         int64_t end_ns,
+                         const AllocationCounters& allocations);
+
+// Count, total, average and maximum time of each phase, by decreasing total, and the allocations
+// if they're tracked. Nested phases are included in the enclosing ones.
+void print_time_report(FILE* f);
+// Chrome trace-event JSON (chrome://tracing, Perfetto) with one track per thread.
+bool write_chrome_trace(const std::string& path);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char* name)
+        : name(g_timing.enabled && enter_timing_scope(name) ? name : nullptr)
+    {
+        if (this->name) {
+            begin_allocations = this_thread_allocation_counters();
+            begin_ns = timing_now_ns();
+        }
+    }
+    ~ScopedTimer()
+    {
+        if (name) {
+            auto end_ns = timing_now_ns();
+            auto a = this_thread_allocation_counters();
+            a.allocs -= begin_allocations.allocs;
+            a.frees -= begin_allocations.frees;
+            a.bytes -= begin_allocations.bytes;
+            record_timing_event(name, begin_ns, end_ns, a);
+            exit_timing_scope();
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    int64_t begin_ns = 0;
+    AllocationCounters begin_allocations;
+};
+
+#define FORREST_TIMING_CAT2(A, B) A##B
+#define FORREST_TIMING_CAT(A, B) FORREST_TIMING_CAT2(A, B)
+
+#ifdef FORREST_DISABLE_TIMING
+#define TIME_SCOPE(NAME) ((void)0)
+#else
+#define TIME_SCOPE(NAME) \
+    ::forrest::ScopedTimer FORREST_TIMING_CAT(scoped_timer_, __LINE__)(NAME)
+#endif
+
+}  // namespace forrest
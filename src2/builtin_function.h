@@ -26,7 +26,7 @@ struct InnerFunctionDefinition
     using InferTypeOfTermFunction =
         std::function<optional<TermPtr>(Store& store, Context& context)>;
 
-    string name;  // for debugging
+    string name;  // For debugging, and to find the builtin when loading a snapshot.
     InnerFunctionSignature signature;
     EvaluateTermFunction evaluate_term_function;
     InferTypeOfTermFunction infer_type_of_term_function;
@@ -35,5 +35,5 @@ struct InnerFunctionDefinition
 using BuiltinFunctionMap = unordered_map<BuiltinFunction, int>;
 using InnerFunctionMap = unordered_map<int, InnerFunctionDefinition>;
 
-unordered_map<BuiltinFunction, InnerFunctionDefinition> MakeBuiltinFunctions();
+unordered_map<BuiltinFunction, InnerFunctionDefinition> MakeBuiltinFunctions(Store& store);
 }  // namespace snl
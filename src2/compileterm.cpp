@@ -3,12 +3,14 @@
 #include "evaluateorcompileterm.h"
 #include "freevariablesofterm.h"
 #include "store.h"
+#include "util/timing.h"
 
 namespace snl {
 
 // Product a term which can be evaluated to a value if all free variables are bound.
 optional<TermPtr> CompileTerm(Store& store, const Context& context, TermPtr term)
 {
+    TIME_SCOPE("CompileTerm");
     // All free variables of this term must be bound.
     auto* fv = GetFreeVariables(store, term);
     for (auto [k, v] : fv->variables) {
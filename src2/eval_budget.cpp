@@ -0,0 +1,181 @@
+#include "eval_budget.h"
+
+#include "astops.h"
+#include "module.h"
+#include "util/timing.h"
+
+namespace snl {
+
+struct ActiveEvaluationBudget
+{
+    ActiveEvaluationBudget(const EvaluationBudget& budget, int64_t begin_ns)
+        : budget(budget), begin_ns(begin_ns)
+    {}
+
+    EvaluationBudget budget;
+    int64_t begin_ns;
+    int64_t steps = 0;
+    optional<EvaluateTermError::Tag> exhausted;
+    int64_t exhausted_ns = 0;
+    vector<term::Abstraction const*> stack;
+    unordered_map<term::Abstraction const*, int64_t> calls;
+    // Recorded when the budget runs out, before the evaluation unwinds.
+    vector<term::Abstraction const*> hottest_cycle;
+    int64_t hottest_cycle_calls = 0;
+};
+
+thread_local ActiveEvaluationBudget* g_active_evaluation_budget = nullptr;
+
+namespace {
+
+// Of the abstractions which are on the stack more than once, the one called the most times, and
+// the stack from its last but one call up to its last call. Later pairs replace earlier ones with
+// as many calls, so the innermost repetition is kept.
+void FindHottestCycle(ActiveEvaluationBudget& b)
+{
+    unordered_map<term::Abstraction const*, int> last_index;
+    for (int i = 0; i < int(b.stack.size()); ++i) {
+        auto a = b.stack[i];
+        auto it = last_index.find(a);
+        if (it != last_index.end()) {
+            auto calls = b.calls[a];
+            if (calls >= b.hottest_cycle_calls) {
+                b.hottest_cycle_calls = calls;
+                b.hottest_cycle.assign(b.stack.begin() + it->second, b.stack.begin() + i);
+            }
+        }
+        last_index[a] = i;
+    }
+}
+
+void Exhaust(ActiveEvaluationBudget& b, EvaluateTermError::Tag tag, int64_t now_ns)
+{
+    b.exhausted = tag;
+    b.exhausted_ns = now_ns - b.begin_ns;
+    FindHottestCycle(b);
+}
+
+string AbstractionName(term::Abstraction const* abstraction,
+                       const unordered_map<TermPtr, string>& names)
+{
+    auto it = names.find(abstraction);
+    if (it != names.end()) {
+        return it->second;
+    }
+    string parameters;
+    for (auto& p : abstraction->parameters) {
+        parameters += (parameters.empty() ? "" : ", ") + p.variable->name;
+    }
+    return fmt::format("<abstraction>({})", parameters);
+}
+
+// Puts a budget in effect for its lifetime, then the outer one again.
+class ScopedActiveEvaluationBudget
+{
+public:
+    explicit ScopedActiveEvaluationBudget(ActiveEvaluationBudget* budget)
+        : outer(g_active_evaluation_budget)
+    {
+        g_active_evaluation_budget = budget;
+    }
+    ~ScopedActiveEvaluationBudget() { g_active_evaluation_budget = outer; }
+    ScopedActiveEvaluationBudget(const ScopedActiveEvaluationBudget&) = delete;
+    ScopedActiveEvaluationBudget& operator=(const ScopedActiveEvaluationBudget&) = delete;
+
+private:
+    ActiveEvaluationBudget* outer;
+};
+
+}  // namespace
+
+bool ConsumeEvaluationStepSlow()
+{
+    auto& b = *g_active_evaluation_budget;
+    if (b.exhausted) {
+        return false;
+    }
+    if (b.budget.max_steps > 0 && b.steps == b.budget.max_steps) {
+        Exhaust(b, EvaluateTermError::Tag::StepBudgetExhausted, forrest::timing_now_ns());
+        return false;
+    }
+    ++b.steps;
+    if (b.budget.max_ns > 0 && b.steps % kEvaluationBudgetTimeCheckInterval == 0) {
+        auto now_ns = forrest::timing_now_ns();
+        if (now_ns - b.begin_ns > b.budget.max_ns) {
+            Exhaust(b, EvaluateTermError::Tag::TimeBudgetExhausted, now_ns);
+            return false;
+        }
+    }
+    return true;
+}
+
+void EvaluationBudgetFrame::Push(term::Abstraction const* abstraction)
+{
+    budget->stack.push_back(abstraction);
+    ++budget->calls[abstraction];
+}
+
+void EvaluationBudgetFrame::Pop()
+{
+    budget->stack.pop_back();
+}
+
+EvaluateTermResult EvaluateTermWithBudget(Store& store,
+                                          const Context& context,
+                                          TermPtr term,
+                                          const EvaluationBudget& budget)
+{
+    ActiveEvaluationBudget active(budget, forrest::timing_now_ns());
+    optional<TermPtr> result;
+    {
+        ScopedActiveEvaluationBudget scope(&active);
+        result = EvaluateTerm(store, context, term);
+    }
+
+    if (active.exhausted) {
+        return EvaluateTermError{*active.exhausted, active.steps, active.exhausted_ns,
+                                 move(active.hottest_cycle), active.hottest_cycle_calls};
+    }
+    if (!result) {
+        return EvaluateTermError{EvaluateTermError::Tag::Failed, active.steps,
+                                 forrest::timing_now_ns() - active.begin_ns, {}, 0};
+    }
+    return *result;
+}
+
+string FormatEvaluateTermError(const EvaluateTermError& error, const Module* module)
+{
+    string message;
+    switch (error.tag) {
+        case EvaluateTermError::Tag::Failed:
+            return fmt::format("Evaluation failed after {} steps.", error.steps);
+        case EvaluateTermError::Tag::StepBudgetExhausted:
+            message = fmt::format("Evaluation exceeded its budget of {} steps ({:.3f} ms).",
+                                  error.steps, error.ns / 1e6);
+            break;
+        case EvaluateTermError::Tag::TimeBudgetExhausted:
+            message = fmt::format("Evaluation exceeded its time budget after {:.3f} ms ({} steps).",
+                                  error.ns / 1e6, error.steps);
+            break;
+    }
+    if (error.hottest_cycle.empty()) {
+        return message;
+    }
+    unordered_map<TermPtr, string> names;
+    if (module) {
+        for (auto& statement : module->statements) {
+            if (auto* tlb = std::get_if<TopLevelBinding>(&statement)) {
+                names.insert(make_pair(tlb->term, tlb->name));
+            }
+        }
+    }
+    string cycle;
+    for (auto a : error.hottest_cycle) {
+        cycle += AbstractionName(a, names) + " -> ";
+    }
+    cycle += AbstractionName(error.hottest_cycle.front(), names);
+    return fmt::format("{} Hottest recursion: {} ({} calls).", message, cycle,
+                       error.hottest_cycle_calls);
+}
+
+}  // namespace snl
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "common.h"
+#include "term.h"
+
+#include <cstdint>
+
+namespace snl {
+
+struct Module;
+
+// Limits of the work of a comptime evaluation, so a diverging metaprogram fails instead of hanging
+// the compiler. Zero means unlimited.
+struct EvaluationBudget
+{
+    int64_t max_steps = 0;  // Calls of EvaluateTerm.
+    int64_t max_ns = 0;     // Wall time, checked every kEvaluationBudgetTimeCheckInterval steps.
+};
+
+const int64_t kEvaluationBudgetTimeCheckInterval = 1024;
+
+struct EvaluateTermError
+{
+    enum class Tag
+    {
+        Failed,  // EvaluateTerm returned nullopt for another reason.
+        StepBudgetExhausted,
+        TimeBudgetExhausted
+    } tag;
+    int64_t steps = 0;
+    int64_t ns = 0;
+    // Recursion on the evaluation stack when the budget ran out: the abstractions from the last but
+    // one call of the most called recursive abstraction to its last call. Empty if there was none.
+    vector<term::Abstraction const*> hottest_cycle;
+    int64_t hottest_cycle_calls = 0;  // Calls of the first abstraction of the cycle.
+};
+
+using EvaluateTermResult = either<EvaluateTermError, TermPtr>;
+
+// EvaluateTerm within `budget`. Budgets can be nested, the inner one is in effect.
+EvaluateTermResult EvaluateTermWithBudget(Store& store,
+                                          const Context& context,
+                                          TermPtr term,
+                                          const EvaluationBudget& budget);
+
+// The abstractions of the cycle are named by the top-level bindings of `module` if it's given.
+string FormatEvaluateTermError(const EvaluateTermError& error, const Module* module);
+
+// The state of the budget in effect on this thread, used by the evaluator.
+struct ActiveEvaluationBudget;
+extern thread_local ActiveEvaluationBudget* g_active_evaluation_budget;
+
+bool ConsumeEvaluationStepSlow();
+// Returns false if the budget is exhausted, EvaluateTerm returns nullopt then.
+inline bool ConsumeEvaluationStep()
+{
+    return !g_active_evaluation_budget || ConsumeEvaluationStepSlow();
+}
+
+// Tracks the abstractions being evaluated for finding the recursion cycles.
+class EvaluationBudgetFrame
+{
+public:
+    explicit EvaluationBudgetFrame(term::Abstraction const* abstraction)
+        : budget(g_active_evaluation_budget)
+    {
+        if (budget) {
+            Push(abstraction);
+        }
+    }
+    ~EvaluationBudgetFrame()
+    {
+        if (budget) {
+            Pop();
+        }
+    }
+    EvaluationBudgetFrame(const EvaluationBudgetFrame&) = delete;
+    EvaluationBudgetFrame& operator=(const EvaluationBudgetFrame&) = delete;
+
+private:
+    ActiveEvaluationBudget* budget;
+
+    void Push(term::Abstraction const* abstraction);
+    void Pop();
+};
+
+}  // namespace snl
@@ -0,0 +1,271 @@
+#include "eval_profiler.h"
+
+#include <algorithm>
+
+#include "builtin_function.h"
+#include "module.h"
+#include "util/timing.h"
+
+#if FORREST_ALLOC_TRACKING
+#include "util/alloc_tracking.h"
+#endif
+
+namespace snl {
+
+bool g_eval_profiler_enabled = false;
+
+namespace {
+
+struct Costs
+{
+    int64_t steps = 0;
+    int64_t ns = 0;
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+
+    Costs operator-(const Costs& y) const
+    {
+        return Costs{steps - y.steps, ns - y.ns, allocs - y.allocs, bytes - y.bytes};
+    }
+    Costs& operator+=(const Costs& y)
+    {
+        steps += y.steps;
+        ns += y.ns;
+        allocs += y.allocs;
+        bytes += y.bytes;
+        return *this;
+    }
+};
+
+struct Function
+{
+    explicit Function(string name) : name(move(name)) {}
+
+    string name;
+    int64_t calls = 0;
+    Costs self;
+    Costs total;
+    int n_active = 0;  // Recursion depth.
+};
+
+struct CallNode
+{
+    int function;
+    int parent;
+    unordered_map<int, int> children;  // By function.
+    Costs self;
+};
+
+struct ActiveFrame
+{
+    int node;
+    Costs at_begin;
+    Costs in_callees;
+};
+
+const int kRootFunction = 0;
+
+// Evaluation isn't multithreaded (the Store isn't thread-safe), the profile is global.
+struct Profile
+{
+    int64_t steps = 0;
+    vector<Function> functions;
+    unordered_map<const void*, int> function_ids;  // By abstraction or builtin.
+    vector<CallNode> nodes;
+    vector<ActiveFrame> stack;
+    unordered_map<term::Abstraction const*, string> names;
+    int n_unnamed_abstractions = 0;
+} g_profile;
+int g_profile_number = 0;
+
+Costs Now()
+{
+    Costs c;
+    c.steps = g_profile.steps;
+    c.ns = forrest::timing_now_ns();
+#if FORREST_ALLOC_TRACKING
+    auto a = forrest::this_thread_allocation_counters();
+    c.allocs = a.allocs;
+    c.bytes = a.bytes;
+#endif
+    return c;
+}
+
+string AbstractionName(term::Abstraction const* abstraction)
+{
+    auto it = g_profile.names.find(abstraction);
+    if (it != g_profile.names.end()) {
+        return it->second;
+    }
+    string parameters;
+    for (auto& p : abstraction->parameters) {
+        parameters += (parameters.empty() ? "" : ",") + p.variable->name;
+    }
+    return fmt::format("<abstraction #{}>({})", ++g_profile.n_unnamed_abstractions, parameters);
+}
+
+int FunctionId(term::Abstraction const* abstraction, InnerFunctionDefinition const* builtin)
+{
+    const void* key = abstraction ? static_cast<const void*>(abstraction) : builtin;
+    auto itb = g_profile.function_ids.insert(make_pair(key, int(g_profile.functions.size())));
+    if (itb.second) {
+        g_profile.functions.push_back(
+            Function{abstraction ? AbstractionName(abstraction) : "builtin " + builtin->name});
+    }
+    return itb.first->second;
+}
+
+void Push(int function)
+{
+    int node = 0;
+    if (!g_profile.stack.empty()) {
+        auto parent = g_profile.stack.back().node;
+        auto itb = g_profile.nodes[parent].children.insert(
+            make_pair(function, int(g_profile.nodes.size())));
+        if (itb.second) {
+            g_profile.nodes.push_back(CallNode{function, parent, {}, {}});
+        }
+        node = itb.first->second;
+    }
+    ++g_profile.functions[function].calls;
+    ++g_profile.functions[function].n_active;
+    g_profile.stack.push_back(ActiveFrame{node, Now(), Costs()});
+}
+
+void Pop()
+{
+    auto frame = g_profile.stack.back();
+    g_profile.stack.pop_back();
+    auto elapsed = Now() - frame.at_begin;
+    auto self = elapsed - frame.in_callees;
+    auto& node = g_profile.nodes[frame.node];
+    node.self += self;
+    auto& function = g_profile.functions[node.function];
+    function.self += self;
+    if (--function.n_active == 0) {
+        function.total += elapsed;
+    }
+    if (!g_profile.stack.empty()) {
+        g_profile.stack.back().in_callees += elapsed;
+    }
+}
+
+string StackName(int node)
+{
+    auto& n = g_profile.nodes[node];
+    auto name = g_profile.functions[n.function].name;
+    std::replace(BE(name), ';', ':');
+    return n.function == kRootFunction ? name : StackName(n.parent) + ";" + name;
+}
+
+}  // namespace
+
+void EnableEvalProfiler()
+{
+    g_profile = Profile();
+    ++g_profile_number;
+    g_profile.functions.push_back(Function{"<root>"});
+    g_profile.nodes.push_back(CallNode{kRootFunction, -1, {}, {}});
+    Push(kRootFunction);
+    g_eval_profiler_enabled = true;
+}
+
+void DisableEvalProfiler()
+{
+    if (!g_eval_profiler_enabled) {
+        return;
+    }
+    g_eval_profiler_enabled = false;
+    // Frames still active (when called from within an evaluation) end here.
+    while (!g_profile.stack.empty()) {
+        Pop();
+    }
+}
+
+void SetEvalProfilerName(term::Abstraction const* abstraction, string name)
+{
+    g_profile.names[abstraction] = move(name);
+}
+
+void SetEvalProfilerNames(const Module& module)
+{
+    for (auto& statement : module.statements) {
+        if (auto* tlb = std::get_if<TopLevelBinding>(&statement)) {
+            if (tlb->term->tag == term::Tag::Abstraction) {
+                SetEvalProfilerName(term_cast<term::Abstraction>(tlb->term), tlb->name);
+            }
+        }
+    }
+}
+
+void CountEvaluationStepSlow()
+{
+    ++g_profile.steps;
+}
+
+int EvalProfilerFrame::Begin(term::Abstraction const* abstraction,
+                             InnerFunctionDefinition const* builtin)
+{
+    Push(FunctionId(abstraction, builtin));
+    return g_profile_number;
+}
+
+void EvalProfilerFrame::End(int profile)
+{
+    // The frames of a profile are ended when it's disabled.
+    if (g_eval_profiler_enabled && profile == g_profile_number) {
+        Pop();
+    }
+}
+
+void PrintEvalProfile(FILE* f)
+{
+    vector<const Function*> sorted;
+    for (auto& function : g_profile.functions) {
+        sorted.push_back(&function);
+    }
+    std::sort(BE(sorted), [](const Function* x, const Function* y) {
+        return x->self.ns > y->self.ns || (x->self.ns == y->self.ns && x->name < y->name);
+    });
+#if FORREST_ALLOC_TRACKING
+    fmt::print(f, "{:>10} {:>10} {:>12} {:>12} {:>12} {:>12} {:>10} {:>10}  {}\n", "self ms",
+               "total ms", "self steps", "total steps", "calls", "self allocs", "self MB",
+               "total MB", "function");
+#else
+    fmt::print(f, "{:>10} {:>10} {:>12} {:>12} {:>12}  {}\n", "self ms", "total ms", "self steps",
+               "total steps", "calls", "function");
+#endif
+    for (auto function : sorted) {
+        fmt::print(f, "{:>10.3f} {:>10.3f} {:>12} {:>12} {:>12} ", function->self.ns / 1e6,
+                   function->total.ns / 1e6, function->self.steps, function->total.steps,
+                   function->calls);
+#if FORREST_ALLOC_TRACKING
+        fmt::print(f, "{:>12} {:>10.3f} {:>10.3f} ", function->self.allocs,
+                   function->self.bytes / 1e6, function->total.bytes / 1e6);
+#endif
+        fmt::print(f, " {}\n", function->name);
+    }
+}
+
+bool WriteEvalProfileCollapsedStacks(const string& path)
+{
+    auto f = fopen(path.c_str(), "w");
+    if (!f) {
+        fmt::print(stderr, "Can't open {} for writing.\n", path);
+        return false;
+    }
+    for (int i = 0; i < int(g_profile.nodes.size()); ++i) {
+        auto us = g_profile.nodes[i].self.ns / 1000;
+        if (us > 0) {
+            fmt::print(f, "{} {}\n", StackName(i), us);
+        }
+    }
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        fmt::print(stderr, "Error writing {}.\n", path);
+    }
+    return ok;
+}
+
+}  // namespace snl
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+#include "term.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace snl {
+
+struct InnerFunctionDefinition;
+struct Module;
+
+// Profiler of comptime evaluation. Attributes the evaluation steps (calls of EvaluateTerm), the
+// wall time and, with allocation tracking (util/alloc_tracking.h), the allocations to the
+// abstractions and builtins whose bodies are being evaluated. Disabled by default, then a frame is
+// a single test of a global flag.
+//
+// The costs are recorded in a call tree: a function has a node for each distinct stack it's
+// called from. Self costs exclude the callees, total costs of a recursive function count only
+// its outermost calls. Evaluation outside of any function is attributed to a root frame.
+
+extern bool g_eval_profiler_enabled;
+
+// Starts a new profile.
+void EnableEvalProfiler();
+// Stops profiling, the profile is kept for the reports.
+void DisableEvalProfiler();
+
+// Name of an abstraction in the reports, usually the top-level binding it's bound to. Others are
+// named by their parameters. Names are set after EnableEvalProfiler(), the functions are keyed by
+// address so the profiled terms must outlive the profiling.
+void SetEvalProfilerName(term::Abstraction const* abstraction, string name);
+// Names the abstractions of the top-level bindings of `module`.
+void SetEvalProfilerNames(const Module& module);
+
+void CountEvaluationStepSlow();
+inline void CountEvaluationStep()
+{
+    if (g_eval_profiler_enabled) {
+        CountEvaluationStepSlow();
+    }
+}
+
+// Flat profile by decreasing self time.
+void PrintEvalProfile(FILE* f);
+// Collapsed stacks ("root;caller;callee <self microseconds>" lines) for flamegraph.pl, speedscope
+// and similar tools.
+bool WriteEvalProfileCollapsedStacks(const string& path);
+
+class EvalProfilerFrame
+{
+public:
+    explicit EvalProfilerFrame(term::Abstraction const* abstraction)
+        : profile(g_eval_profiler_enabled ? Begin(abstraction, nullptr) : 0)
+    {}
+    explicit EvalProfilerFrame(InnerFunctionDefinition const* builtin)
+        : profile(g_eval_profiler_enabled ? Begin(nullptr, builtin) : 0)
+    {}
+    ~EvalProfilerFrame()
+    {
+        if (profile) {
+            End(profile);
+        }
+    }
+    EvalProfilerFrame(const EvalProfilerFrame&) = delete;
+    EvalProfilerFrame& operator=(const EvalProfilerFrame&) = delete;
+
+private:
+    int profile;  // Counts EnableEvalProfiler() calls, 0 if not profiling.
+
+    static int Begin(term::Abstraction const* abstraction, InnerFunctionDefinition const* builtin);
+    static void End(int profile);
+};
+
+}  // namespace snl
@@ -1,8 +1,11 @@
 #include "astops.h"
 
+#include "eval_budget.h"
+#include "eval_profiler.h"
 #include "evaluateorcompileterm.h"
 #include "store.h"
 #include "unify.h"
+#include "util/timing.h"
 
 namespace snl {
 
@@ -136,8 +139,13 @@ optional<TermPtr> EvaluateApplication(Store& store,
             assert(forall_variables.empty());
 
             // Evaluate body.
-            VAL_FROM_OPT_ELSE_RETURN(
-                evaluated_body, EvaluateTerm(store, inner_context, abstraction->body), nullopt);
+            optional<TermPtr> maybe_evaluated_body;
+            {
+                EvalProfilerFrame profiler_frame(abstraction);
+                EvaluationBudgetFrame budget_frame(abstraction);
+                maybe_evaluated_body = EvaluateTerm(store, inner_context, abstraction->body);
+            }
+            VAL_FROM_OPT_ELSE_RETURN(evaluated_body, maybe_evaluated_body, nullopt);
 
             if (!remaining_arguments.empty()) {
                 return evaluated_body;
@@ -147,10 +155,82 @@ optional<TermPtr> EvaluateApplication(Store& store,
                 store.MakeCanonical(term::Application(evaluated_body, move(remaining_arguments)));
             return EvaluateTerm(store, context, evaluated_body);
         }
+        case term::Tag::CppTerm: {
+            // Builtin, its evaluate function looks up its arguments in the context.
+            auto it = store.inner_function_map.find(
+                term_cast<term::CppTerm>(evaluated_function)->id);
+            ASSERT_ELSE(it != store.inner_function_map.end(), return nullopt;);
+            auto& definition = it->second;
+            auto& signature = definition.signature;
+            auto& parameters = signature.parameters;
+
+            int n_args = application->arguments.size();
+            int n_pars = parameters.size();
+            int n_applied_args = std::min(n_args, n_pars);
+
+            Context inner_context(&context);
+            vector<BoundVariable> bound_variables;
+            for (int i = 0; i < n_applied_args; ++i) {
+                VAL_FROM_OPT_ELSE_RETURN(
+                    evaluated_arg, EvaluateTerm(store, context, application->arguments[i]),
+                    nullopt);
+                bound_variables.push_back(BoundVariable{parameters[i].variable, evaluated_arg});
+                inner_context.Bind(parameters[i].variable, evaluated_arg);
+            }
+
+            if (n_args < n_pars) {
+                // Partial application: return an abstraction of the remaining parameters which
+                // applies the builtin to all of its parameters, the applied ones are bound.
+                //
+                //     Appl (builtin x y z) (ax)
+                //
+                // becomes
+                //
+                //     Abstr [x = eval(ax)] (y z)
+                //         Appl (builtin x y z) (x y z)
+                //
+                unordered_set<term::Variable const*> forall_variables =
+                    signature.forall_variables;  // Copy.
+                vector<TermPtr> inner_arguments;
+                for (auto& par : parameters) {
+                    inner_arguments.push_back(par.variable);
+                }
+                for (int i = 0; i < n_applied_args; ++i) {
+                    forall_variables.erase(parameters[i].variable);
+                }
+                auto inner_application = store.MakeCanonical(
+                    term::Application(evaluated_function, move(inner_arguments)));
+                vector<Parameter> remaining_parameters(parameters.begin() + n_applied_args,
+                                                       parameters.end());
+                MOVE_FROM_OPT_ELSE_RETURN(
+                    new_abstraction,
+                    term::Abstraction::MakeAbstraction(
+                        store, move(forall_variables), move(bound_variables),
+                        move(remaining_parameters), inner_application),
+                    nullopt);
+                return store.MakeCanonical(move(new_abstraction));
+            }
+
+            optional<TermPtr> maybe_result;
+            {
+                EvalProfilerFrame profiler_frame(&definition);
+                maybe_result = definition.evaluate_term_function(store, inner_context);
+            }
+            VAL_FROM_OPT_ELSE_RETURN(result, maybe_result, nullopt);
+            if (n_args == n_pars) {
+                return result;
+            }
+
+            // The builtin returned a function, apply it to the remaining arguments.
+            vector<TermPtr> remaining_arguments(application->arguments.begin() + n_applied_args,
+                                                application->arguments.end());
+            auto new_application =
+                store.MakeCanonical(term::Application(result, move(remaining_arguments)));
+            return EvaluateTerm(store, context, new_application);
+        }
         case term::Tag::LetIns:
         case term::Tag::Application:
         case term::Tag::Variable:
-        case term::Tag::CppTerm:
         case term::Tag::StringLiteral:
         case term::Tag::NumericLiteral:
         case term::Tag::UnitLikeValue:
@@ -167,6 +247,11 @@ optional<TermPtr> EvaluateApplication(Store& store,
 
 optional<TermPtr> EvaluateTerm(Store& store, const Context& context, TermPtr term)
 {
+    TIME_SCOPE("EvaluateTerm");
+    CountEvaluationStep();
+    if (!ConsumeEvaluationStep()) {
+        return nullopt;  // Out of the budget of EvaluateTermWithBudget().
+    }
     using Tag = term::Tag;
     switch (term->tag) {
         case Tag::Abstraction:
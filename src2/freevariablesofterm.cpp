@@ -24,11 +24,13 @@ FreeVariables GetFreeVariablesCore(Store& store, TermPtr term)
                 auto* fvs_of_value = GetFreeVariables(store, it->value);
                 fvs.insert(BE(*fvs_of_value));
             }
-            fvs.erase(BE(abstraction->forall_variables));
+            for (auto v : abstraction->forall_variables) {
+                fvs.erase(v);
+            }
             return fvs;
         }
         case Tag::LetIns: {
-            auto let_ins = term_cast<term::Abstraction>(term);
+            auto let_ins = term_cast<term::LetIns>(term);
             auto fvs = *GetFreeVariables(store, let_ins->body);
             for (auto it = let_ins->bound_variables.rbegin(); it != let_ins->bound_variables.rend();
                  ++it) {
@@ -53,6 +55,7 @@ FreeVariables GetFreeVariablesCore(Store& store, TermPtr term)
         case Tag::NumericLiteral:
         case Tag::UnitLikeValue:
         case Tag::SimpleTypeTerm:
+        case Tag::CppTerm:
             assert(false);  // This should be caught in GetFreeVariables().
             return empty_fvs;
         case Tag::DeferredValue:
@@ -78,11 +81,22 @@ FreeVariables GetFreeVariablesCore(Store& store, TermPtr term)
                 }
                 fvs.insert(BE(*fvs_p));
             }
-            auto* fvs_result_type = GetFreeVariables(store, function_type->result_type);
-            fvs.insert(BE(*fvs_result_type));
-            fvs.erase(BE(function_type->forall_variables));
+            auto* fvs_return_type = GetFreeVariables(store, function_type->return_type);
+            fvs.insert(BE(*fvs_return_type));
+            for (auto v : function_type->forall_variables) {
+                fvs.erase(v);
+            }
             return fvs;
         }
+        case Tag::NamedType: {
+            auto named_type = term_cast<term::NamedType>(term);
+            if (!named_type->type_constructor) {
+                return empty_fvs;
+            }
+            return *GetFreeVariables(store, named_type->type_constructor);
+        }
+        case Tag::TypeOfAbstraction:
+            return *GetFreeVariables(store, term_cast<term::TypeOfAbstraction>(term)->abstraction);
         case Tag::ProductType: {
             auto product_type = term_cast<term::ProductType>(term);
             FreeVariables fvs;
@@ -102,6 +116,7 @@ FreeVariables const* GetFreeVariables(Store& store, TermPtr term)
         case Tag::StringLiteral:
         case Tag::NumericLiteral:
         case Tag::SimpleTypeTerm:
+        case Tag::CppTerm:  // Builtins are closed.
             const static FreeVariables empty_fv;
             return &empty_fv;
         case Tag::UnitLikeValue: {
@@ -111,13 +126,8 @@ FreeVariables const* GetFreeVariables(Store& store, TermPtr term)
         default:
             break;
     }
-    auto it = store.free_variables_of_terms.find(term);
-    if (it == store.free_variables_of_terms.end()) {
-        it = store.free_variables_of_terms
-                 .insert(make_pair(term, store.MakeCanonical(GetFreeVariablesCore(store, term))))
-                 .first;
-    }
-    return it->second;
+    return store.GetOrInsertFreeVariablesOfTerm(
+        term, [&store, term]() { return GetFreeVariablesCore(store, term); });
 }
 
 }  // namespace snl
@@ -2,38 +2,90 @@
 
 namespace snl {
 
-string FormatIndentedLines(const IndentedLines& indentedLines, bool emptyLineAfter)
+IndentedLinesWriter::IndentedLinesWriter(std::FILE* out) : file(out), buffer(&file_buffer)
 {
-    constexpr int kIndentationUnit = 4;
-    int indentation = 0;
-    string result;
-    if (indentedLines.empty()) {
-        return result;
+    file_buffer.reserve(kFlushSize);
+}
+
+IndentedLinesWriter::IndentedLinesWriter(string* out) : buffer(out) {}
+
+IndentedLinesWriter::~IndentedLinesWriter()
+{
+    Flush();
+}
+
+void IndentedLinesWriter::Indent()
+{
+    ++indentation;
+}
+
+void IndentedLinesWriter::Dedent()
+{
+    if (--indentation < 0) {
+        assert(false);
+        indentation = 0;
+    }
+}
+
+void IndentedLinesWriter::Write(string_view s)
+{
+    if (at_line_start) {
+        buffer->append(indentation * kIndentationUnit, ' ');
+        at_line_start = false;
+    }
+    buffer->append(s);
+}
+
+void IndentedLinesWriter::EndLine()
+{
+    Write({});
+    buffer->push_back('\n');
+    at_line_start = true;
+    if (file && buffer->size() >= kFlushSize) {
+        Flush();
+    }
+}
+
+void IndentedLinesWriter::Flush()
+{
+    if (file) {
+        fwrite(buffer->data(), 1, buffer->size(), file);
+        buffer->clear();
     }
+}
+
+void WriteIndentedLines(const IndentedLines& indentedLines, IndentedLinesWriter& writer)
+{
     for (auto& line : indentedLines) {
         switch_variant(
             line,
-            [&indentation](ChangeIndentation changeIndentation) {
+            [&writer](ChangeIndentation changeIndentation) {
                 switch (changeIndentation) {
                     case ChangeIndentation::Indent:
-                        ++indentation;
+                        writer.Indent();
                         break;
                     case ChangeIndentation::Dedent:
-                        if (--indentation < 0) {
-                            assert(false);
-                            indentation = 0;
-                        }
+                        writer.Dedent();
                         break;
                 }
             },
-            [indentation, &result](const string& s) {
-                int spaces = indentation * kIndentationUnit;
-                result.reserve(result.size() + spaces + s.size() + 1);
-                result.append(spaces, ' ');
-                result.append(s);
-                result.push_back('\n');
+            [&writer](const string& s) {
+                writer.Write(s);
+                writer.EndLine();
             });
     }
+}
+
+string FormatIndentedLines(const IndentedLines& indentedLines, bool emptyLineAfter)
+{
+    string result;
+    if (indentedLines.empty()) {
+        return result;
+    }
+    {
+        IndentedLinesWriter writer(&result);
+        WriteIndentedLines(indentedLines, writer);
+    }
     if (emptyLineAfter) {
         result.push_back('\n');
     }
@@ -44,8 +96,15 @@ string FormatBlocksOfIndentedLines(const vector<IndentedLines>& blocks, bool emp
 {
     string result;
     for (int i = 0; i < blocks.size(); ++i) {
-        result += FormatIndentedLines(blocks[i], emptyLineAfter || i + 1 < blocks.size());
+        if (blocks[i].empty()) {
+            continue;
+        }
+        IndentedLinesWriter writer(&result);
+        WriteIndentedLines(blocks[i], writer);
+        if (emptyLineAfter || i + 1 < blocks.size()) {
+            result.push_back('\n');
+        }
     }
     return result;
 }
-}  // namespace snl
\ No newline at end of file
+}  // namespace snl
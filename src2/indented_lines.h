@@ -2,6 +2,8 @@
 
 #include "common.h"
 
+#include <cstdio>
+
 namespace snl {
 
 enum class ChangeIndentation
@@ -12,7 +14,36 @@ enum class ChangeIndentation
 using IndentedLine = variant<ChangeIndentation, string>;
 using IndentedLines = vector<IndentedLine>;  // Dedent back to zero is implicit at the end.
 
+// Streams indented text into a string or, through a fixed-size buffer, into a FILE*. A line is
+// built with any number of Write() calls and closed with EndLine().
+class IndentedLinesWriter
+{
+public:
+    explicit IndentedLinesWriter(std::FILE* out);
+    explicit IndentedLinesWriter(string* out);
+    ~IndentedLinesWriter();
+    IndentedLinesWriter(const IndentedLinesWriter&) = delete;
+    IndentedLinesWriter& operator=(const IndentedLinesWriter&) = delete;
+
+    void Indent();
+    void Dedent();
+    void Write(string_view s);
+    void EndLine();
+    void Flush();
+
+private:
+    static constexpr int kIndentationUnit = 4;
+    static constexpr size_t kFlushSize = 64 * 1024;
+
+    std::FILE* file = nullptr;
+    string file_buffer;
+    string* buffer;
+    int indentation = 0;
+    bool at_line_start = true;
+};
+
+void WriteIndentedLines(const IndentedLines& indentedLines, IndentedLinesWriter& writer);
 string FormatIndentedLines(const IndentedLines& indentedLines, bool emptyLineAfter);
 string FormatBlocksOfIndentedLines(const vector<IndentedLines>& blocks, bool emptyLineAfter);
 
-}  // namespace snl
\ No newline at end of file
+}  // namespace snl
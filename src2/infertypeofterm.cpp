@@ -3,6 +3,7 @@
 #include "freevariablesofterm.h"
 #include "store.h"
 #include "unify.h"
+#include "util/timing.h"
 
 namespace snl {
 
@@ -197,6 +198,9 @@ optional<InferCalleeTypesResult> InferCalleeTypes(Store& store,
                                                   TermPtr callee_term,
                                                   const vector<TermPtr>& arguments)
 {
+    // The terms made while trying to unify the arguments with a callee that doesn't fit are
+    // garbage.
+    StoreSpeculation speculation(store);
     VAL_FROM_OPT_ELSE_RETURN(callee_type, InferTypeOfTerm(store, context, callee_term), nullopt);
 
     term::FunctionType const* function_type = nullptr;
@@ -276,12 +280,14 @@ optional<InferCalleeTypesResult> InferCalleeTypes(Store& store,
     if (!result_type) {
         return nullopt;
     }
+    speculation.Commit();
     return InferCalleeTypesResult{move(parameter_types), move(forall_variables),
                                   move(remaining_parameter_types), *result_type};
 }
 
 optional<TermPtr> InferTypeOfTerm(Store& store, const Context& context, TermPtr term)
 {
+    TIME_SCOPE("InferTypeOfTerm");
     using Tag = term::Tag;
     switch (term->tag) {
         case Tag::Abstraction:
@@ -1,26 +1,264 @@
+#include <algorithm>
 #include <cstdlib>
 
 #include "ast.h"
 #include "astops.h"
 #include "common.h"
+#include "eval_budget.h"
+#include "eval_profiler.h"
+#include "module.h"
+#include "query.h"
 #include "samples.h"
 #include "store.h"
+#include "store_gc.h"
 #include "term.h"
+#include "term_benchmark.h"
+#include "term_printer.h"
+#include "util/timing.h"
 
 const std::string kCmakeCurrentSourceDir = CMAKE_CURRENT_SOURCE_DIR;
 
+namespace snl {
+namespace {
+
+// Writes the interface of sample 1 into `interface_dir`, then compiles sample 2, which imports it,
+// in a new Store: the terms of sample 1 and their types come from the interface file only.
+bool RunImportingSample(Store& store,
+                        const Context& context,
+                        const Module& sample1,
+                        const string& interface_dir,
+                        const EvaluationBudget& eval_budget)
+{
+    TIME_SCOPE("RunImportingSample");
+    Store importer_store;
+    ModuleInterfaces interfaces(importer_store, interface_dir);
+    if (!WriteModuleInterface(store, context, sample1, interfaces.PathOf("sample1"))) {
+        fmt::print(stderr, "Can't write the interface of sample1 into {}.\n", interface_dir);
+        return false;
+    }
+    auto sample2 = MakeSample2(importer_store);
+    Context importer_context(nullptr);
+    if (!interfaces.BindImports(sample2, importer_context)) {
+        fmt::print(stderr, "Can't bind the imports of sample2 from {}.\n", interface_dir);
+        return false;
+    }
+    auto& tlb = std::get<TopLevelBinding>(sample2.statements[1]);
+    auto unit_value = importer_store.MakeCanonical(term::UnitLikeValue(importer_store.unit_type));
+    auto call_main = importer_store.MakeCanonical(
+        term::Application(tlb.term, vector<TermPtr>({unit_value})));
+    auto main_result =
+        EvaluateTermWithBudget(importer_store, importer_context, call_main, eval_budget);
+    if (is_left(main_result)) {
+        fmt::print(stderr, "Evaluating `{}` of sample2: {}\n", tlb.name,
+                   FormatEvaluateTermError(left(main_result), &sample2));
+        return false;
+    }
+    return true;
+}
+
+// Compiles the top-level bindings of `module` through a QueryEngine and checks that the engine
+// survives the events which may invalidate the terms it holds: a garbage collection must not
+// force any query to be computed again, a rolled back speculative query must be.
+bool CompileWithQueryEngine(Store& store, const Module& module, const Context& context)
+{
+    TIME_SCOPE("CompileWithQueryEngine");
+    QueryEngine engine(store);
+    vector<string> names;
+    for (auto& statement : module.statements) {
+        if (auto* tlb = std::get_if<TopLevelBinding>(&statement)) {
+            engine.SetBinding(tlb->name, tlb->term);
+            names.push_back(tlb->name);
+        }
+    }
+    auto compile_all = [&]() {
+        for (auto& name : names) {
+            if (!engine.CompileBinding(name)) {
+                fmt::print(stderr, "Query engine: can't compile `{}`.\n", name);
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!compile_all()) {
+        return false;
+    }
+
+    auto n_computed = engine.NumComputed();
+    GcRoots roots;
+    roots.AddModule(module);
+    roots.AddContext(context);
+    roots.AddQueryEngine(engine);
+    CollectGarbage(store, roots);
+    if (!compile_all()) {
+        return false;
+    }
+    if (engine.NumComputed() != n_computed) {
+        fmt::print(stderr, "Query engine: {} queries computed again after a GC.\n",
+                   engine.NumComputed() - n_computed);
+        return false;
+    }
+
+    // A term made under a checkpoint is deleted by the rollback, the canonical term made after it
+    // may be a new term at the same address.
+    VAL_FROM_OPT_ELSE_RETURN(main_variable, engine.BindingVariable(names.front()), false);
+    auto unit_value = store.MakeCanonical(term::UnitLikeValue(store.unit_type));
+    auto make_call_main = [&]() {
+        return store.MakeCanonical(
+            term::Application(main_variable, vector<TermPtr>({unit_value})));
+    };
+    {
+        StoreSpeculation speculation(store);
+        if (!engine.EvaluateTerm(make_call_main())) {
+            fmt::print(stderr, "Query engine: can't evaluate `{}`.\n", names.front());
+            return false;
+        }
+    }
+    n_computed = engine.NumComputed();
+    if (!engine.EvaluateTerm(make_call_main())) {
+        fmt::print(stderr, "Query engine: can't evaluate `{}`.\n", names.front());
+        return false;
+    }
+    if (engine.NumComputed() == n_computed) {
+        fmt::print(stderr, "Query engine: used a memo of a rolled back query.\n");
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+}  // namespace snl
+
 int main(int argc, char* argv[])
 {
     using namespace snl;
-    Store store;
-    auto module = MakeSample1(store);
-    auto& tlb = std::get<TopLevelBinding>(module.statements[0]);
-    auto main_abstraction = tlb.term;
-    Context context(nullptr);
-    auto unit_value = store.MakeCanonical(term::UnitLikeValue(store.unit_type));
-    auto call_main =
-        store.MakeCanonical(term::Application(main_abstraction, vector<TermPtr>({unit_value})));
-    auto main_result = EvaluateTerm(store, context, call_main);
-    assert(main_result);
-    return EXIT_SUCCESS;
+    bool time_report = false;
+    string trace_out;
+    bool bench = false;
+    int bench_repetitions = 5;
+    string bench_json;
+    bool eval_profile = false;
+    string eval_profile_stacks;
+    EvaluationBudget eval_budget;
+    optional<GcPolicy> gc_policy;
+    bool dump_terms = false;
+    string interface_dir;
+    bool query_engine = false;
+    for (int i = 1; i < argc; ++i) {
+        string_view a = argv[i];
+        if (a == "--time-report") {
+            time_report = true;
+        } else if (a == "--trace-out" && i + 1 < argc) {
+            trace_out = argv[++i];
+        } else if (a == "--eval-profile") {
+            eval_profile = true;
+        } else if (a == "--eval-profile-stacks" && i + 1 < argc) {
+            eval_profile_stacks = argv[++i];
+        } else if (a == "--eval-max-steps" && i + 1 < argc) {
+            eval_budget.max_steps = std::max(0LL, atoll(argv[++i]));
+        } else if (a == "--eval-max-ms" && i + 1 < argc) {
+            eval_budget.max_ns = std::max(0LL, atoll(argv[++i])) * 1000000;
+        } else if (a == "--gc-threshold" && i + 1 < argc) {
+            gc_policy = GcPolicy();
+            gc_policy->min_threshold = std::max(0LL, atoll(argv[++i]));
+        } else if (a == "--dump-terms") {
+            dump_terms = true;
+        } else if (a == "--interface-dir" && i + 1 < argc) {
+            interface_dir = argv[++i];
+        } else if (a == "--query-engine") {
+            query_engine = true;
+        } else if (a == "--bench") {
+            bench = true;
+        } else if (a == "--bench-repetitions" && i + 1 < argc) {
+            bench_repetitions = std::max(1, atoi(argv[++i]));
+        } else if (a == "--bench-json" && i + 1 < argc) {
+            bench_json = argv[++i];
+        } else {
+            fmt::print(stderr,
+                       "Usage: {} [--time-report] [--trace-out <filename>]\n"
+                       "       [--eval-profile] [--eval-profile-stacks <filename>]\n"
+                       "       [--eval-max-steps <n>] [--eval-max-ms <n>]\n"
+                       "       [--gc-threshold <terms>] [--dump-terms] [--interface-dir <dir>]\n"
+                       "       [--query-engine]\n"
+                       "       [--bench [--bench-repetitions <n>] [--bench-json <filename>]]\n",
+                       argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (time_report || !trace_out.empty()) {
+        forrest::enable_timing();
+    }
+    if (eval_profile || !eval_profile_stacks.empty()) {
+        EnableEvalProfiler();
+    }
+
+    bool ok = true;
+    if (bench) {
+        ok = RunTermBenchmark(SyntheticModuleShape(), bench_repetitions, bench_json);
+    } else {
+        Store store;
+        auto module = MakeSample1(store);
+        SetEvalProfilerNames(module);
+        if (dump_terms) {
+            vector<pair<string, TermPtr>> roots;
+            for (auto& statement : module.statements) {
+                if (auto* binding = std::get_if<TopLevelBinding>(&statement)) {
+                    roots.emplace_back(binding->name, binding->term);
+                }
+            }
+            IndentedLinesWriter writer(stdout);
+            auto stats = PrintTermDag(roots, writer);
+            writer.Flush();
+            fmt::print(stderr, "{} distinct terms, {} as trees, {} shared\n", stats.dag_size,
+                       stats.tree_size, stats.n_shared);
+        }
+        auto& tlb = std::get<TopLevelBinding>(module.statements[0]);
+        auto main_abstraction = tlb.term;
+        Context context(nullptr);
+        auto unit_value = store.MakeCanonical(term::UnitLikeValue(store.unit_type));
+        auto call_main = store.MakeCanonical(
+            term::Application(main_abstraction, vector<TermPtr>({unit_value})));
+        // The budget applies to the evaluation of each top-level binding.
+        auto main_result = EvaluateTermWithBudget(store, context, call_main, eval_budget);
+        if (is_left(main_result)) {
+            fmt::print(stderr, "Evaluating `{}`: {}\n", tlb.name,
+                       FormatEvaluateTermError(left(main_result), &module));
+            ok = false;
+        }
+        if (ok && !interface_dir.empty()) {
+            ok = RunImportingSample(store, context, module, interface_dir, eval_budget);
+        }
+        if (ok && query_engine) {
+            ok = CompileWithQueryEngine(store, module, context);
+        }
+        // Between top-level bindings, only the module and its context are live.
+        if (gc_policy) {
+            GarbageCollector collector(*gc_policy);
+            auto stats = collector.MaybeCollect(store, [&](GcRoots& roots) {
+                roots.AddModule(module);
+                roots.AddContext(context);
+            });
+            if (stats && time_report) {
+                PrintGcStats(stderr, *stats);
+            }
+        }
+        if (time_report) {
+            PrintTermPoolStats(stderr, store.term_pools);
+        }
+    }
+
+    forrest::disable_timing();
+    if (time_report) {
+        forrest::print_time_report(stderr);
+    }
+    DisableEvalProfiler();
+    if (eval_profile) {
+        PrintEvalProfile(stderr);
+    }
+    if (!eval_profile_stacks.empty() && !WriteEvalProfileCollapsedStacks(eval_profile_stacks)) {
+        ok = false;
+    }
+    if (!trace_out.empty() && !forrest::write_chrome_trace(trace_out)) {
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
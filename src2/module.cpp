@@ -1,3 +1,102 @@
 #include "module.h"
 
-namespace snl {}
+#include "astops.h"
+#include "store.h"
+#include "store_snapshot.h"
+
+#include <cstring>
+
+namespace snl {
+
+namespace {
+
+// Root names in the snapshot of an interface.
+const char* const kImportPrefix = "import:";
+const char* const kTermPrefix = "term:";
+const char* const kTypePrefix = "type:";
+
+}  // namespace
+
+bool WriteModuleInterface(Store& store,
+                          const Context& context,
+                          const Module& module,
+                          const string& path)
+{
+    vector<pair<string, TermPtr>> roots;
+    for (auto& statement : module.statements) {
+        if (auto* import = std::get_if<Import>(&statement)) {
+            roots.emplace_back(kImportPrefix + import->module_name, nullptr);
+            continue;
+        }
+        auto& tlb = std::get<TopLevelBinding>(statement);
+        VAL_FROM_OPT_ELSE_RETURN(type, InferTypeOfTerm(store, context, tlb.term), false);
+        roots.emplace_back(kTermPrefix + tlb.name, tlb.term);
+        roots.emplace_back(kTypePrefix + tlb.name, type);
+    }
+    return SaveRootsSnapshot(store, roots, path);
+}
+
+optional<ModuleInterface> LoadModuleInterface(Store& store, const string& path)
+{
+    MOVE_FROM_OPT_ELSE_RETURN(snapshot, StoreSnapshot::Load(path), nullopt);
+    // The snapshot has only what's reachable from the exports so build all of it, this also
+    // restores the type cache.
+    snapshot.MaterializeAll(store);
+    ModuleInterface mi;
+    for (uint32_t i = 0; i < snapshot.NumRoots(); ++i) {
+        auto name = snapshot.RootName(i);
+        auto index = snapshot.RootTerm(i);
+        if (starts_with(name, kImportPrefix)) {
+            mi.imports.emplace_back(name.substr(strlen(kImportPrefix)));
+        } else if (starts_with(name, kTermPrefix)) {
+            mi.exports[string(name.substr(strlen(kTermPrefix)))].term =
+                snapshot.Materialize(store, index);
+        } else if (starts_with(name, kTypePrefix)) {
+            mi.exports[string(name.substr(strlen(kTypePrefix)))].type =
+                snapshot.Materialize(store, index);
+        }
+    }
+    for (auto& [name, e] : mi.exports) {
+        ASSERT_ELSE(e.term && e.type, return nullopt;);
+    }
+    return mi;
+}
+
+string ModuleInterfaces::PathOf(const string& module_name) const
+{
+    return directory + "/" + module_name + ".snli";
+}
+
+const ModuleInterface* ModuleInterfaces::Get(const string& module_name)
+{
+    auto it = loaded.find(module_name);
+    if (it == loaded.end()) {
+        it = loaded.insert(make_pair(module_name, LoadModuleInterface(store, PathOf(module_name))))
+                 .first;
+    }
+    return it->second ? &*it->second : nullptr;
+}
+
+bool ModuleInterfaces::BindImports(const Module& module, Context& context)
+{
+    for (auto& statement : module.statements) {
+        auto* import = std::get_if<Import>(&statement);
+        if (!import) {
+            continue;
+        }
+        auto mi = Get(import->module_name);
+        if (!mi) {
+            return false;
+        }
+        for (auto& [name, variable] : import->variables) {
+            auto it = mi->exports.find(name);
+            if (it == mi->exports.end()) {
+                return false;
+            }
+            context.Bind(variable, it->second.term);
+        }
+    }
+    return true;
+}
+
+}  // namespace snl
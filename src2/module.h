@@ -1,17 +1,29 @@
 #pragma once
 
 #include "common.h"
+#include "context.h"
 #include "term.h"
 
 namespace snl {
 
+struct Store;
+class GcRoots;
+
 struct TopLevelBinding
 {
     string name;
     TermPtr term;
 };
 
-using ModuleStatement = variant<TopLevelBinding>;
+// Makes exported bindings of another module available. The module refers to them through
+// `variables`, which are bound to the imported terms in the module's context.
+struct Import
+{
+    string module_name;
+    unordered_map<string, term::Variable const*> variables;  // By exported name.
+};
+
+using ModuleStatement = variant<TopLevelBinding, Import>;
 
 // Context gives a unique key for nodes which share these attributes:
 // - same lexical context/scope (lambda abstraction introduces new lexical context)
@@ -24,4 +36,50 @@ struct Module
     Module(vector<ModuleStatement>&& statements) : statements(move(statements)) {}
     vector<ModuleStatement> statements;
 };
+
+// What other modules need from a compiled module: the terms of the top-level bindings (so generic
+// functions can be specialized) and their inferred types. Types of the terms within the exported
+// terms are in the type cache of the Store, so importing a module doesn't infer its types again.
+struct ModuleInterface
+{
+    struct Export
+    {
+        TermPtr term;
+        TermPtr type;
+    };
+    vector<string> imports;  // Names of the imported modules.
+    unordered_map<string, Export> exports;
+};
+
+// Infers the types of the top-level bindings of `module` in `context` (in which the imports are
+// already bound) and writes the interface. Returns false if a type can't be inferred or on I/O
+// error.
+bool WriteModuleInterface(Store& store,
+                          const Context& context,
+                          const Module& module,
+                          const string& path);
+// Loads the terms and the types of an interface into `store`.
+optional<ModuleInterface> LoadModuleInterface(Store& store, const string& path);
+
+// Loads each module interface once, from `<directory>/<module name>.snli`.
+class ModuleInterfaces
+{
+public:
+    ModuleInterfaces(Store& store, string directory) : store(store), directory(move(directory)) {}
+
+    string PathOf(const string& module_name) const;
+    const ModuleInterface* Get(const string& module_name);
+
+    // Binds the variables of the imports of `module` in `context`. Returns false if an interface or
+    // an imported name is missing.
+    bool BindImports(const Module& module, Context& context);
+
+private:
+    friend class GcRoots;
+
+    Store& store;
+    string directory;
+    unordered_map<string, optional<ModuleInterface>> loaded;
+};
+
 }  // namespace snl
@@ -20,7 +20,7 @@ TypePtr Store::MakeCanonicalCommon(Type&& t)
     auto it = canonical_types.find(tw);
     if (it == canonical_types.end()) {
         bool b;
-        tie(it, b) = canonical_types.emplace(move(tw));
+        std::tie(it, b) = canonical_types.emplace(move(tw));
         assert(b);
     }
     return &*it;
@@ -0,0 +1,239 @@
+#include "query.h"
+
+#include <algorithm>
+
+#include "astops.h"
+#include "store.h"
+
+namespace snl {
+
+using query::Key;
+using query::Kind;
+using query::Value;
+
+namespace {
+
+optional<TermPtr> AsTerm(const Value& value)
+{
+    if (auto* p = std::get_if<TermPtr>(&value)) {
+        return *p;
+    }
+    return nullopt;
+}
+
+Value FromOptional(optional<TermPtr> term)
+{
+    return term ? Value(*term) : Value();
+}
+
+}  // namespace
+
+void QueryEngine::SetBinding(const string& name, TermPtr term)
+{
+    auto it = bindings.find(name);
+    if (it == bindings.end()) {
+        auto variable = store.MakeNewVariable(true, make_copy(name));
+        context.Bind(variable, term);
+        bindings.insert(make_pair(name, Binding{variable, term, ++revision}));
+        return;
+    }
+    auto& b = it->second;
+    if (b.term == term) {
+        return;
+    }
+    b.term = term;
+    b.changed_at = ++revision;
+    context.Rebind(b.variable, term);
+}
+
+optional<term::Variable const*> QueryEngine::BindingVariable(const string& name) const
+{
+    auto it = bindings.find(name);
+    if (it == bindings.end()) {
+        return nullopt;
+    }
+    return it->second.variable;
+}
+
+optional<TermPtr> QueryEngine::BindingTerm(const string& name)
+{
+    return AsTerm(Get(Key{Kind::BindingTerm, nullptr, name}));
+}
+
+FreeVariables const* QueryEngine::FreeVariablesOf(TermPtr term)
+{
+    auto& value = Get(Key{Kind::FreeVariables, term, {}});
+    auto* p = std::get_if<FreeVariables const*>(&value);
+    ASSERT_ELSE(p, return nullptr;);
+    return *p;
+}
+
+optional<TermPtr> QueryEngine::TypeOfTerm(TermPtr term)
+{
+    return AsTerm(Get(Key{Kind::TypeOfTerm, term, {}}));
+}
+
+optional<TermPtr> QueryEngine::EvaluateTerm(TermPtr term)
+{
+    return AsTerm(Get(Key{Kind::EvaluateTerm, term, {}}));
+}
+
+optional<TermPtr> QueryEngine::CompileBinding(const string& name)
+{
+    return AsTerm(Get(Key{Kind::CompileBinding, nullptr, name}));
+}
+
+const Value& QueryEngine::Get(const Key& key)
+{
+    if (active.empty()) {
+        ForgetRolledBackMemos();
+    }
+    auto& memo = memos[key];
+    if (memo.in_progress) {
+        auto it = std::find(BE(active_keys), key);
+        last_cycle.assign(it, active_keys.end());
+        // Not recorded as a dependency, a cycle goes through bindings whose changes are tracked
+        // by the queries in the cycle.
+        static const Value failed;
+        return failed;
+    }
+    RecordDependency(key);
+    Refresh(key);
+    return memo.value;
+}
+
+void QueryEngine::ForgetRolledBackMemos()
+{
+    if (seen_rollbacks == store.NumRollbacks()) {
+        return;
+    }
+    seen_rollbacks = store.NumRollbacks();
+    if (speculative_keys.empty()) {
+        return;
+    }
+    for (auto& key : speculative_keys) {
+        memos.erase(key);
+    }
+    speculative_keys.clear();
+    // The dependents of the dropped memos must not be revalidated against new memos which start
+    // at revision 0, so everything is checked again.
+    ++revision;
+}
+
+void QueryEngine::RecordDependency(const Key& key)
+{
+    if (!active.empty()) {
+        active.back()->dependencies.push_back(key);
+    }
+}
+
+QueryEngine::Revision QueryEngine::Refresh(const Key& key)
+{
+    auto& memo = memos[key];
+    if (key.kind == Kind::BindingTerm) {
+        // Inputs are always up to date, a missing binding counts as unchanged since the start.
+        auto it = bindings.find(key.name);
+        if (it == bindings.end()) {
+            memo.value = Value();
+            memo.changed_at = 0;
+        } else {
+            memo.value = it->second.term;
+            memo.changed_at = it->second.changed_at;
+        }
+        memo.verified_at = revision;
+        return memo.changed_at;
+    }
+    if (memo.in_progress) {
+        // The dependencies recorded in an earlier revision form a cycle, compute again.
+        return revision;
+    }
+    if (memo.verified_at == revision) {
+        return memo.changed_at;
+    }
+
+    memo.in_progress = true;
+    if (memo.verified_at > 0 && DependenciesUnchangedSince(memo)) {
+        memo.in_progress = false;
+        memo.verified_at = revision;
+        return memo.changed_at;
+    }
+
+    memo.dependencies.clear();
+    active.push_back(&memo);
+    active_keys.push_back(key);
+    auto value = Compute(key);
+    active.pop_back();
+    active_keys.pop_back();
+    memo.in_progress = false;
+    ++n_computed;
+    if (!memo.speculative && store.HasOpenCheckpoints()) {
+        memo.speculative = true;
+        speculative_keys.push_back(key);
+    }
+
+    // Keep `changed_at` if the value is the same, so the dependent queries stay valid.
+    if (memo.verified_at == 0 || value != memo.value) {
+        memo.value = value;
+        memo.changed_at = revision;
+    }
+    memo.verified_at = revision;
+    return memo.changed_at;
+}
+
+bool QueryEngine::DependenciesUnchangedSince(const Memo& memo)
+{
+    for (auto& d : memo.dependencies) {
+        if (Refresh(d) > memo.verified_at) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QueryEngine::DependOnBindingsOf(TermPtr term, Kind kind)
+{
+    auto fvs = FreeVariablesOf(term);
+    ASSERT_ELSE(fvs, return false;);
+    for (auto& [name, b] : bindings) {
+        if (fvs->count(b.variable) == 0) {
+            continue;
+        }
+        VAL_FROM_OPT_ELSE_RETURN(binding_term, BindingTerm(name), false);
+        if (holds_alternative<monostate>(Get(Key{kind, binding_term, {}}))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Value QueryEngine::Compute(const Key& key)
+{
+    switch (key.kind) {
+        case Kind::BindingTerm:
+            UNREACHABLE;
+            return Value();
+        case Kind::FreeVariables:
+            return GetFreeVariables(store, key.term);
+        case Kind::TypeOfTerm:
+            if (!DependOnBindingsOf(key.term, Kind::TypeOfTerm)) {
+                return Value();
+            }
+            return FromOptional(InferTypeOfTerm(store, context, key.term));
+        case Kind::EvaluateTerm:
+            if (!DependOnBindingsOf(key.term, Kind::EvaluateTerm)) {
+                return Value();
+            }
+            return FromOptional(snl::EvaluateTerm(store, context, key.term));
+        case Kind::CompileBinding: {
+            VAL_FROM_OPT_ELSE_RETURN(term, BindingTerm(key.name), Value());
+            if (!TypeOfTerm(term)) {
+                return Value();
+            }
+            return FromOptional(CompileTerm(store, context, term));
+        }
+    }
+    UNREACHABLE;
+    return Value();
+}
+
+}  // namespace snl
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "common.h"
+#include "context.h"
+#include "freevariablesofterm.h"
+#include "term.h"
+
+namespace snl {
+
+struct Store;
+
+// Demand-driven compilation of the top-level bindings of a program. The results are memoized
+// queries which record the queries they used. When a binding changes only the queries depending
+// on it are computed again, the others are revalidated by walking their dependencies (like the
+// red-green algorithm of rustc and salsa).
+//
+// The memos hold the terms of their keys and values, a GC must root them with
+// GcRoots::AddQueryEngine. Memos computed while the Store has an open checkpoint may refer to terms
+// a Rollback deletes, they are dropped before the next outermost query after a Rollback.
+//
+// The bindings are bound in the context of the queries through comptime variables, so the type
+// cache of the Store, which keys terms by their comptime free variables, is never stale.
+namespace query {
+
+enum class Kind
+{
+    BindingTerm,    // Input: term of the binding `name`.
+    FreeVariables,  // Free variables of `term`.
+    TypeOfTerm,     // Type of `term` in the context of the bindings.
+    EvaluateTerm,   // Value of `term` in the context of the bindings.
+    CompileBinding  // Compiled form of the binding `name`.
+};
+
+struct Key
+{
+    Kind kind;
+    TermPtr term = nullptr;
+    string name;
+
+    bool operator==(const Key& y) const
+    {
+        return kind == y.kind && term == y.term && name == y.name;
+    }
+};
+
+// monostate if the query failed, including being part of a cycle. Terms are canonical so equal
+// values are equal pointers.
+using Value = variant<monostate, TermPtr, FreeVariables const*>;
+
+}  // namespace query
+}  // namespace snl
+
+namespace std {
+template <>
+struct hash<snl::query::Key>
+{
+    std::size_t operator()(const snl::query::Key& x) const noexcept
+    {
+        auto h = snl::hash_value(x.kind);
+        snl::hash_combine(h, x.term);
+        snl::hash_combine(h, x.name);
+        return h;
+    }
+};
+}  // namespace std
+
+namespace snl {
+
+class QueryEngine
+{
+public:
+    using Revision = uint64_t;
+
+    explicit QueryEngine(Store& store) : store(store) {}
+    QueryEngine(const QueryEngine&) = delete;
+
+    // Adds or changes an input binding.
+    void SetBinding(const string& name, TermPtr term);
+    // The variable through which terms refer to the binding `name`.
+    optional<term::Variable const*> BindingVariable(const string& name) const;
+
+    optional<TermPtr> BindingTerm(const string& name);
+    FreeVariables const* FreeVariablesOf(TermPtr term);
+    optional<TermPtr> TypeOfTerm(TermPtr term);
+    optional<TermPtr> EvaluateTerm(TermPtr term);
+    optional<TermPtr> CompileBinding(const string& name);
+
+    const query::Value& Get(const query::Key& key);
+
+    Revision CurrentRevision() const { return revision; }
+    // The queries of the last cycle found, in the order they were entered.
+    const vector<query::Key>& LastCycle() const { return last_cycle; }
+    // Number of times a query was computed (not just revalidated), for testing the engine.
+    int NumComputed() const { return n_computed; }
+
+private:
+    struct Binding
+    {
+        term::Variable const* variable;
+        TermPtr term;
+        Revision changed_at;
+    };
+    struct Memo
+    {
+        query::Value value;
+        Revision verified_at = 0;  // The value is known to be valid at this revision.
+        Revision changed_at = 0;   // Last revision the value changed.
+        vector<query::Key> dependencies;
+        bool in_progress = false;
+        bool speculative = false;  // Computed while the Store had an open checkpoint.
+    };
+
+    Store& store;
+    Context context{nullptr};  // Binds the variables of the bindings to their terms.
+    unordered_map<string, Binding> bindings;
+    unordered_map<query::Key, Memo> memos;
+    Revision revision = 1;
+    vector<Memo*> active;  // Stack of the queries being computed.
+    vector<query::Key> active_keys;
+    vector<query::Key> last_cycle;
+    int n_computed = 0;
+    vector<query::Key> speculative_keys;
+    uint64_t seen_rollbacks = 0;
+
+    friend class GcRoots;
+
+    // Drops the speculative memos if the Store was rolled back since the last call.
+    void ForgetRolledBackMemos();
+    void RecordDependency(const query::Key& key);
+    // Returns the revision the value of the query last changed.
+    Revision Refresh(const query::Key& key);
+    bool DependenciesUnchangedSince(const Memo& memo);
+    query::Value Compute(const query::Key& key);
+    // Makes the query depend on the bindings referred to by `term`. Returns false if one of them
+    // doesn't exist or the `kind` query of its term fails.
+    bool DependOnBindingsOf(TermPtr term, query::Kind kind);
+};
+
+}  // namespace snl
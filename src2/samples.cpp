@@ -36,4 +36,22 @@ Module MakeSample1(Store& store)
     return Module(vector<ModuleStatement>({main_def}));
 #undef MC
 }
+
+Module MakeSample2(Store& store)
+{
+    using namespace term;
+#define MC store.MakeCanonical
+    auto sample1_main = store.MakeNewVariable(false, "sample1_main");
+    auto import = Import{"sample1", {{"main", sample1_main}}};
+    auto call_sample1_main = MC(
+        Application(sample1_main, vector<TermPtr>({MC(UnitLikeValue(store.unit_type))})));
+    auto main_lambda = MC(Abstraction(
+        Abstraction::UncheckedConstructor(), {}, vector<BoundVariable>(),
+        vector<Parameter>({Parameter{store.MakeNewVariable(false, make_copy(store.s_ignored_name)),
+                                     store.unit_type}}),
+        call_sample1_main));
+    auto main_def = TopLevelBinding{"main", main_lambda};
+    return Module(vector<ModuleStatement>({import, main_def}));
+#undef MC
+}
 }  // namespace snl
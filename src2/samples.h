@@ -5,4 +5,6 @@
 
 namespace snl {
 Module MakeSample1(Store& store);
+// Imports `main` of MakeSample1 from the module "sample1" and calls it from its own `main`.
+Module MakeSample2(Store& store);
 }
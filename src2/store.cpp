@@ -9,38 +9,17 @@ Store::Store()
       comptime_type_value(MakeCanonical(
           term::DeferredValue(type_of_types, term::DeferredValue::Availability::Comptime))),
       comptime_value_comptime_type(MakeCanonical(
-          term::DeferredValue(comptime_type_value, term::DeferredValue::Availability::Comptime))),
-      builtin_function_map(MakeBuiltinFunctions())
-{}
+          term::DeferredValue(comptime_type_value, term::DeferredValue::Availability::Comptime)))
+{
+    for (auto& [builtin_function, definition] : MakeBuiltinFunctions(*this)) {
+        builtin_function_map[builtin_function] = AddInnerFunctionDefinition(move(definition));
+    }
+}
 
 Store::~Store()
 {
     for (auto p : canonical_terms) {
-        using namespace term;
-        switch (p->tag) {
-#define CASE(X)                          \
-    case Tag::X:                         \
-        delete static_cast<X const*>(p); \
-        break;
-            CASE(Abstraction)
-            CASE(LetIns)
-            CASE(Application)
-            CASE(Variable)
-            CASE(BuiltinAbstraction)
-
-            CASE(StringLiteral)
-            CASE(NumericLiteral)
-            CASE(UnitLikeValue)
-            CASE(DeferredValue)
-            CASE(ProductValue)
-
-            CASE(SimpleTypeTerm)
-
-            CASE(FunctionType)
-            CASE(ProductType)
-
-#undef CASE
-        }
+        term_pools.Delete(p);
     }
 }
 
@@ -48,34 +27,34 @@ TermPtr Store::MoveToHeap(Term&& term)
 {
     using namespace term;
     switch (term.tag) {
-#define CASE0(TAG) \
-    case Tag::TAG: \
-        return new TAG();
-#define CASE(TAG, ...)                     \
-    case Tag::TAG: {                       \
-        auto& t = static_cast<TAG&>(term); \
-        return new TAG(__VA_ARGS__);       \
+#define CASE(TAG, ...)                           \
+    case Tag::TAG: {                             \
+        auto& t = static_cast<TAG&>(term);       \
+        return term_pools.New<TAG>(__VA_ARGS__); \
     }
         CASE(Abstraction, Abstraction::UncheckedConstructor{}, move(t.forall_variables),
              move(t.bound_variables), move(t.parameters), t.body)
         CASE(LetIns, move(t.bound_variables), t.body)
         CASE(Application, t.function, move(t.arguments))
         CASE(Variable, t.comptime, move(t.name))
-        CASE(BuiltinAbstraction, t.builtin_function)
+        CASE(CppTerm, t.id)
 
         CASE(StringLiteral, move(t.value))
         CASE(NumericLiteral, move(t.value))
 
         CASE(SimpleTypeTerm, t.simple_type)
-        CASE(FunctionType, move(t.forall_variables), move(t.parameter_types), t.result_type)
+        CASE(NamedType, move(t.name), t.type_constructor)
+        CASE(FunctionType, move(t.forall_variables), move(t.parameter_types), t.return_type)
+        CASE(TypeOfAbstraction, t.abstraction)
         CASE(ProductType, move(t.members))
         CASE(UnitLikeValue, t.type)
         CASE(DeferredValue, t.type, t.availability)
         CASE(ProductValue, term_cast<ProductType>(t.type), move(t.values))
 
-#undef CASE0
 #undef CASE
     }
+    UNREACHABLE;
+    return nullptr;
 }
 
 TermPtr Store::MakeCanonical(Term&& t)
@@ -84,8 +63,9 @@ TermPtr Store::MakeCanonical(Term&& t)
     auto it = canonical_terms.find(&t);
     if (it == canonical_terms.end()) {
         bool b;
-        tie(it, b) = canonical_terms.emplace(MoveToHeap(move(t)));
+        std::tie(it, b) = canonical_terms.emplace(MoveToHeap(move(t)));
         assert(b);
+        AddNewTerm(*it);
     }
     return *it;
 }
@@ -97,10 +77,11 @@ bool Store::IsCanonical(TermPtr t) const
 
 term::Variable const* Store::MakeNewVariable(bool comptime, string&& name)
 {
-    auto p = new term::Variable(
+    auto p = term_pools.New<term::Variable>(
         comptime, name.empty() ? fmt::format("GV#{}", next_generated_variable_id++) : move(name));
     auto itb = canonical_terms.insert(p);
     assert(itb.second);
+    AddNewTerm(p);
     return p;
 }
 
@@ -108,7 +89,26 @@ string const Store::s_ignored_name;  // Empty string.
 
 FreeVariables const* Store::MakeCanonical(FreeVariables&& fv)
 {
-    return &*canonicalized_free_variables.insert(move(fv)).first;
+    auto itb = canonicalized_free_variables.insert(move(fv));
+    if (itb.second && n_open_checkpoints > 0) {
+        new_free_variables.push_back(&*itb.first);
+    }
+    return &*itb.first;
+}
+
+FreeVariables const* Store::GetOrInsertFreeVariablesOfTerm(
+    TermPtr term,
+    std::function<FreeVariables()> make_free_variables_fn)
+{
+    auto it = free_variables_of_terms.find(term);
+    if (it == free_variables_of_terms.end()) {
+        auto fv = MakeCanonical(make_free_variables_fn());
+        it = free_variables_of_terms.insert(make_pair(term, fv)).first;
+        if (n_open_checkpoints > 0) {
+            new_free_variables_of_terms.push_back(term);
+        }
+    }
+    return it->second;
 }
 
 optional<TermPtr> Store::GetOrInsertTypeOfTermInContext(
@@ -124,8 +124,82 @@ optional<TermPtr> Store::GetOrInsertTypeOfTermInContext(
         it =
             types_of_terms_in_context.insert(make_pair(move(term_with_bound_free_variables), *type))
                 .first;
+        if (n_open_checkpoints > 0) {
+            new_types_of_terms_in_context.push_back(&it->first);
+        }
     }
     return it->second;
 }
 
+void Store::DeleteTerms(const vector<TermPtr>& terms)
+{
+    for (auto t : terms) {
+        auto erased = canonical_terms.erase(t);
+        assert(erased == 1);
+        term_pools.Delete(t);
+    }
+}
+
+void Store::AddNewTerm(TermPtr t)
+{
+    if (n_open_checkpoints > 0) {
+        new_terms.push_back(t);
+    }
+}
+
+StoreCheckpoint Store::MakeCheckpoint()
+{
+    ++n_open_checkpoints;
+    return StoreCheckpoint{new_terms.size(),
+                           new_free_variables.size(),
+                           new_free_variables_of_terms.size(),
+                           new_types_of_terms_in_context.size(),
+                           next_inner_function_id,
+                           next_generated_variable_id};
+}
+
+void Store::Rollback(const StoreCheckpoint& checkpoint)
+{
+    ++n_rollbacks;
+    // The caches first, their keys refer to the terms and free variables.
+    for (auto i = checkpoint.n_new_types_of_terms_in_context;
+         i < new_types_of_terms_in_context.size(); ++i) {
+        auto it = types_of_terms_in_context.find(*new_types_of_terms_in_context[i]);
+        assert(it != types_of_terms_in_context.end());
+        types_of_terms_in_context.erase(it);
+    }
+    new_types_of_terms_in_context.resize(checkpoint.n_new_types_of_terms_in_context);
+    for (auto i = checkpoint.n_new_free_variables_of_terms; i < new_free_variables_of_terms.size();
+         ++i) {
+        free_variables_of_terms.erase(new_free_variables_of_terms[i]);
+    }
+    new_free_variables_of_terms.resize(checkpoint.n_new_free_variables_of_terms);
+    for (auto i = checkpoint.n_new_free_variables; i < new_free_variables.size(); ++i) {
+        canonicalized_free_variables.erase(*new_free_variables[i]);
+    }
+    new_free_variables.resize(checkpoint.n_new_free_variables);
+
+    DeleteTerms(vector<TermPtr>(new_terms.begin() + checkpoint.n_new_terms, new_terms.end()));
+    new_terms.resize(checkpoint.n_new_terms);
+
+    for (auto id = checkpoint.next_inner_function_id; id < next_inner_function_id; ++id) {
+        inner_function_map.erase(id);
+    }
+    next_inner_function_id = checkpoint.next_inner_function_id;
+    next_generated_variable_id = checkpoint.next_generated_variable_id;
+
+    Commit(checkpoint);
+}
+
+void Store::Commit(const StoreCheckpoint& checkpoint)
+{
+    assert(n_open_checkpoints > 0 && checkpoint.n_new_terms <= new_terms.size());
+    if (--n_open_checkpoints == 0) {
+        new_terms.clear();
+        new_free_variables.clear();
+        new_free_variables_of_terms.clear();
+        new_types_of_terms_in_context.clear();
+    }
+}
+
 }  // namespace snl
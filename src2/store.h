@@ -4,6 +4,7 @@
 #include "common.h"
 #include "freevariablesofterm.h"
 #include "term.h"
+#include "term_pool.h"
 
 namespace snl {
 struct TermWithBoundFreeVariables
@@ -35,6 +36,17 @@ struct hash<snl::TermWithBoundFreeVariables>
 }  // namespace std
 
 namespace snl {
+// State of a Store to roll back to, see Store::MakeCheckpoint().
+struct StoreCheckpoint
+{
+    size_t n_new_terms;
+    size_t n_new_free_variables;
+    size_t n_new_free_variables_of_terms;
+    size_t n_new_types_of_terms_in_context;
+    int next_inner_function_id;
+    int next_generated_variable_id;
+};
+
 struct Store
 {
     Store();
@@ -47,6 +59,9 @@ struct Store
     optional<TermPtr> GetOrInsertTypeOfTermInContext(
         TermWithBoundFreeVariables&& term_with_bound_free_variables,
         std::function<optional<TermPtr>()> make_type_fn);
+    FreeVariables const* GetOrInsertFreeVariablesOfTerm(
+        TermPtr term,
+        std::function<FreeVariables()> make_free_variables_fn);
     int AddInnerFunctionDefinition(InnerFunctionDefinition&& ifd)
     {
         int id = next_inner_function_id++;
@@ -55,6 +70,8 @@ struct Store
         return id;
     }
 
+    // Declared before the terms made by the constructor.
+    TermPools term_pools;
     unordered_set<TermPtr, TermHash, TermEqual> canonical_terms;
 
     TermPtr const type_of_types;
@@ -74,8 +91,62 @@ struct Store
 
     static string const s_ignored_name;
 
+    // Speculative work (e.g. trying to unify or to infer the types of a candidate callee) creates
+    // terms and cache entries which are garbage if it fails. Everything created after a checkpoint
+    // can be released in bulk by rolling back to it; no term created after the checkpoint may be
+    // used after that. Checkpoints nest and must be closed by Rollback() or Commit() in reverse
+    // order of creation.
+    StoreCheckpoint MakeCheckpoint();
+    void Rollback(const StoreCheckpoint& checkpoint);
+    // Keeps the work done since the checkpoint. It's still rolled back with an enclosing one.
+    void Commit(const StoreCheckpoint& checkpoint);
+    bool HasOpenCheckpoints() const { return n_open_checkpoints > 0; }
+    // Number of Rollback() calls so far. Caches outside the Store which may hold terms created
+    // after a checkpoint compare it to find out if those terms may have been deleted.
+    uint64_t NumRollbacks() const { return n_rollbacks; }
+
+    // Removes the terms from canonical_terms and frees them. Nothing may refer to them, including
+    // the caches.
+    void DeleteTerms(const vector<TermPtr>& terms);
+
 private:
     TermPtr MoveToHeap(Term&& t);
+    void AddNewTerm(TermPtr t);
     int next_generated_variable_id = 1;
+
+    // Journal of the insertions since the outermost open checkpoint, empty if there's none.
+    int n_open_checkpoints = 0;
+    uint64_t n_rollbacks = 0;
+    vector<TermPtr> new_terms;
+    vector<FreeVariables const*> new_free_variables;
+    vector<TermPtr> new_free_variables_of_terms;
+    vector<TermWithBoundFreeVariables const*> new_types_of_terms_in_context;
+};
+
+// Rolls back the Store at the end of the scope unless the speculative work is committed.
+class StoreSpeculation
+{
+public:
+    explicit StoreSpeculation(Store& store) : store(store), checkpoint(store.MakeCheckpoint()) {}
+    ~StoreSpeculation()
+    {
+        if (!committed) {
+            store.Rollback(checkpoint);
+        }
+    }
+    StoreSpeculation(const StoreSpeculation&) = delete;
+    StoreSpeculation& operator=(const StoreSpeculation&) = delete;
+
+    void Commit()
+    {
+        assert(!committed);
+        store.Commit(checkpoint);
+        committed = true;
+    }
+
+private:
+    Store& store;
+    StoreCheckpoint const checkpoint;
+    bool committed = false;
 };
 }  // namespace snl
@@ -0,0 +1,274 @@
+#include "store_gc.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "module.h"
+#include "query.h"
+#include "util/timing.h"
+
+namespace snl {
+
+void GcRoots::AddTerm(TermPtr term)
+{
+    if (term) {
+        terms.push_back(term);
+    }
+}
+
+void GcRoots::AddModule(const Module& module)
+{
+    for (auto& statement : module.statements) {
+        if (auto* tlb = std::get_if<TopLevelBinding>(&statement)) {
+            AddTerm(tlb->term);
+        } else if (auto* import = std::get_if<Import>(&statement)) {
+            for (auto& [name, variable] : import->variables) {
+                AddTerm(variable);
+            }
+        }
+    }
+}
+
+void GcRoots::AddContext(const Context& context)
+{
+    for (auto c = &context; c; c = c->parent) {
+        for (auto& [variable, value] : c->variables) {
+            AddTerm(variable);
+            AddTerm(value);
+        }
+    }
+}
+
+void GcRoots::AddModuleInterface(const ModuleInterface& module_interface)
+{
+    for (auto& [name, e] : module_interface.exports) {
+        AddTerm(e.term);
+        AddTerm(e.type);
+    }
+}
+
+void GcRoots::AddModuleInterfaces(const ModuleInterfaces& module_interfaces)
+{
+    for (auto& [name, module_interface] : module_interfaces.loaded) {
+        if (module_interface) {
+            AddModuleInterface(*module_interface);
+        }
+    }
+}
+
+void GcRoots::AddQueryEngine(const QueryEngine& query_engine)
+{
+    AddContext(query_engine.context);
+    for (auto& [key, memo] : query_engine.memos) {
+        // The key terms keep their free-variables entries, so FreeVariables values stay valid.
+        AddTerm(key.term);
+        if (auto* p = std::get_if<TermPtr>(&memo.value)) {
+            AddTerm(*p);
+        }
+    }
+}
+
+namespace {
+
+using TypeCacheEntry = pair<const TermWithBoundFreeVariables, TermPtr>;
+
+class Marker
+{
+public:
+    bool IsMarked(TermPtr t) const { return marked.count(t) > 0; }
+
+    void Mark(TermPtr t)
+    {
+        if (t && marked.insert(t).second) {
+            worklist.push_back(t);
+            if (!waiting.empty()) {
+                Wake(t);
+            }
+        }
+    }
+
+    void Drain()
+    {
+        while (!worklist.empty()) {
+            auto t = worklist.back();
+            worklist.pop_back();
+            MarkChildren(t);
+        }
+    }
+
+    size_t NumMarked() const { return marked.size(); }
+
+    // `entry` is moved to the woken entries when `t` is marked.
+    void WaitFor(TermPtr t, TypeCacheEntry const* entry) { waiting[t].push_back(entry); }
+    void TakeWoken(vector<TypeCacheEntry const*>& entries)
+    {
+        entries.insert(entries.end(), BE(woken));
+        woken.clear();
+    }
+
+private:
+    unordered_set<TermPtr> marked;
+    vector<TermPtr> worklist;
+    unordered_map<TermPtr, vector<TypeCacheEntry const*>> waiting;
+    vector<TypeCacheEntry const*> woken;
+
+    void MarkChildren(TermPtr t)
+    {
+        ForEachSubterm(t, [this](TermPtr u) { Mark(u); });
+    }
+    void Wake(TermPtr t)
+    {
+        auto it = waiting.find(t);
+        if (it != waiting.end()) {
+            woken.insert(woken.end(), BE(it->second));
+            waiting.erase(it);
+        }
+    }
+};
+
+// A term of the key which isn't marked, nullptr if all are.
+TermPtr FindUnmarked(const Marker& marker, const TermWithBoundFreeVariables& key)
+{
+    if (!marker.IsMarked(key.term)) {
+        return key.term;
+    }
+    for (auto& [variable, value] : key.bound_variables.variables) {
+        if (!marker.IsMarked(variable)) {
+            return variable;
+        }
+        if (!marker.IsMarked(value)) {
+            return value;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+GcStats CollectGarbage(Store& store, const GcRoots& roots)
+{
+    TIME_SCOPE("CollectGarbage");
+    ASSERT_ELSE(!store.HasOpenCheckpoints(), return GcStats(););
+    auto begin_ns = forrest::timing_now_ns();
+    GcStats stats;
+
+    Marker marker;
+    for (auto t : {store.type_of_types, store.unit_type, store.string_literal_type,
+                   store.numeric_literal_type, store.comptime_type_value,
+                   store.comptime_value_comptime_type}) {
+        marker.Mark(t);
+    }
+    for (auto& [id, definition] : store.inner_function_map) {
+        for (auto v : definition.signature.forall_variables) {
+            marker.Mark(v);
+        }
+        for (auto& p : definition.signature.parameters) {
+            marker.Mark(p.variable);
+            marker.Mark(p.expected_type);
+        }
+    }
+    for (auto t : roots.Terms()) {
+        marker.Mark(t);
+    }
+    marker.Drain();
+
+    // A cached type is live if the key is: marking it can make other keys live. An entry waits for
+    // one unmarked term of its key at a time and is checked again when that term is marked, so
+    // each entry is checked at most once per term of its key.
+    vector<TypeCacheEntry const*> pending;
+    for (auto& entry : store.types_of_terms_in_context) {
+        pending.push_back(&entry);
+    }
+    unordered_set<TermWithBoundFreeVariables const*> live_type_entries;
+    while (!pending.empty()) {
+        auto entry = pending.back();
+        pending.pop_back();
+        if (auto t = FindUnmarked(marker, entry->first)) {
+            marker.WaitFor(t, entry);
+        } else {
+            live_type_entries.insert(&entry->first);
+            marker.Mark(entry->second);
+            marker.Drain();
+            marker.TakeWoken(pending);
+        }
+    }
+
+    // Sweep the caches first, their keys refer to the terms.
+    for (auto it = store.types_of_terms_in_context.begin();
+         it != store.types_of_terms_in_context.end();) {
+        if (live_type_entries.count(&it->first) == 0) {
+            it = store.types_of_terms_in_context.erase(it);
+            ++stats.swept_types_of_terms_in_context;
+        } else {
+            ++it;
+        }
+    }
+    unordered_set<FreeVariables const*> live_free_variables;
+    for (auto it = store.free_variables_of_terms.begin();
+         it != store.free_variables_of_terms.end();) {
+        if (marker.IsMarked(it->first)) {
+            live_free_variables.insert(it->second);
+            ++it;
+        } else {
+            it = store.free_variables_of_terms.erase(it);
+            ++stats.swept_free_variables_of_terms;
+        }
+    }
+    for (auto it = store.canonicalized_free_variables.begin();
+         it != store.canonicalized_free_variables.end();) {
+        if (live_free_variables.count(&*it) > 0) {
+            ++it;
+        } else {
+            it = store.canonicalized_free_variables.erase(it);
+            ++stats.swept_free_variables;
+        }
+    }
+
+    vector<TermPtr> garbage;
+    for (auto t : store.canonical_terms) {
+        if (!marker.IsMarked(t)) {
+            garbage.push_back(t);
+        }
+    }
+    store.DeleteTerms(garbage);
+
+    stats.live_terms = store.canonical_terms.size();
+    stats.swept_terms = garbage.size();
+    stats.ns = forrest::timing_now_ns() - begin_ns;
+    return stats;
+}
+
+GarbageCollector::GarbageCollector(GcPolicy policy)
+    : policy(policy), threshold(policy.min_threshold)
+{}
+
+bool GarbageCollector::IsDue(const Store& store) const
+{
+    return store.canonical_terms.size() >= threshold;
+}
+
+optional<GcStats> GarbageCollector::MaybeCollect(
+    Store& store,
+    const std::function<void(GcRoots&)>& add_roots)
+{
+    if (!IsDue(store)) {
+        return nullopt;
+    }
+    GcRoots roots;
+    add_roots(roots);
+    auto stats = CollectGarbage(store, roots);
+    threshold = std::max(policy.min_threshold, size_t(stats.live_terms * policy.growth_factor));
+    return stats;
+}
+
+void PrintGcStats(FILE* f, const GcStats& stats)
+{
+    fmt::print(f,
+               "GC: {} live terms, swept {} terms, {} free variable sets, {} free-variables "
+               "entries, {} type cache entries in {:.3f} ms\n",
+               stats.live_terms, stats.swept_terms, stats.swept_free_variables,
+               stats.swept_free_variables_of_terms, stats.swept_types_of_terms_in_context,
+               stats.ns / 1e6);
+}
+
+}  // namespace snl
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+#include "store.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace snl {
+
+struct Module;
+struct ModuleInterface;
+class ModuleInterfaces;
+class QueryEngine;
+
+// Mark-and-sweep collection of the terms of a Store which aren't reachable from the roots.
+//
+// Besides the given roots, the constant terms of the Store and the signatures of the builtins are
+// always live. A type cache entry (Store::types_of_terms_in_context) is kept and its type marked
+// if its term and bound variables are live, a free-variables entry is kept if its term is live;
+// everything else is swept from canonical_terms, the caches and the canonical free variable sets.
+//
+// A collection may only run at a safe point: every term which will be used later (including the
+// TermPtr and FreeVariables pointers held in locals) must be reachable from the roots, and there
+// must be no open Store checkpoint. Evaluation and type inference aren't safe points.
+
+// Collects the root terms.
+class GcRoots
+{
+public:
+    void AddTerm(TermPtr term);
+    void AddModule(const Module& module);
+    // The bindings of the context and of its parents.
+    void AddContext(const Context& context);
+    void AddModuleInterface(const ModuleInterface& module_interface);
+    void AddModuleInterfaces(const ModuleInterfaces& module_interfaces);
+    // The bindings of the engine and the keys and values of its memoized queries.
+    void AddQueryEngine(const QueryEngine& query_engine);
+
+    const vector<TermPtr>& Terms() const { return terms; }
+
+private:
+    vector<TermPtr> terms;
+};
+
+struct GcStats
+{
+    size_t live_terms = 0;
+    size_t swept_terms = 0;
+    size_t swept_free_variables = 0;
+    size_t swept_free_variables_of_terms = 0;
+    size_t swept_types_of_terms_in_context = 0;
+    int64_t ns = 0;
+};
+
+GcStats CollectGarbage(Store& store, const GcRoots& roots);
+
+struct GcPolicy
+{
+    // The heap is measured in canonical terms. A collection is due when the Store has at least
+    // `min_threshold` terms and `growth_factor` times the live terms after the last collection.
+    size_t min_threshold = 100000;
+    double growth_factor = 2.0;
+};
+
+class GarbageCollector
+{
+public:
+    explicit GarbageCollector(GcPolicy policy = GcPolicy());
+
+    bool IsDue(const Store& store) const;
+    // Collects if due, to be called at safe points. `add_roots` is only called then.
+    optional<GcStats> MaybeCollect(Store& store, const std::function<void(GcRoots&)>& add_roots);
+
+private:
+    GcPolicy policy;
+    size_t threshold;
+};
+
+void PrintGcStats(FILE* f, const GcStats& stats);
+
+}  // namespace snl
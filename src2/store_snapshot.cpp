@@ -0,0 +1,643 @@
+#include "store_snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SNL_SNAPSHOT_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define SNL_SNAPSHOT_HAS_MMAP 0
+#endif
+
+namespace snl {
+
+namespace {
+
+using snapshot::Index;
+using snapshot::kNoTerm;
+using snapshot::Span;
+
+constexpr char kMagic[8] = {'S', 'N', 'L', 'S', 'N', 'A', 'P', '\0'};
+
+size_t ExpectedSize(const snapshot::Header& h)
+{
+    return sizeof(snapshot::Header) + size_t(h.n_terms) * sizeof(snapshot::Term) +
+           size_t(h.n_roots) * sizeof(snapshot::Root) +
+           size_t(h.n_free_variables) * sizeof(snapshot::FreeVariablesOfTerm) +
+           size_t(h.n_type_cache_entries) * sizeof(snapshot::TypeCacheEntry) + h.data_size;
+}
+
+// Field usage of snapshot::Term by tag:
+//   Abstraction        lists: forall variables, (variable, value) pairs, (variable, type) pairs;
+//                      a: body
+//   LetIns             lists[1]: (variable, value) pairs; a: body
+//   Application        lists[0]: arguments; a: function
+//   Variable           lists[0]: name; small: comptime
+//   CppTerm            lists[0]: name of the InnerFunctionDefinition, the ids aren't stable
+//   StringLiteral      lists[0]: value
+//   NumericLiteral     lists[0]: numerator and denominator, 2 x int64_t; small: kind
+//   UnitLikeValue      a: type
+//   DeferredValue      a: type; small: availability
+//   ProductValue       lists[0]: (name offset, name size, value) triplets sorted by name; a: type
+//   SimpleTypeTerm     small: simple type
+//   NamedType          lists[0]: name; a: type constructor; small: simple type
+//   FunctionType       lists: forall variables, (type, comptime parameter or kNoTerm) pairs;
+//                      a: return type
+//   TypeOfAbstraction  a: abstraction
+//   ProductType        lists[0]: (name offset, name size, type) triplets sorted by name
+class SnapshotBuilder
+{
+public:
+    explicit SnapshotBuilder(const Store& store) : store(store) {}
+
+    vector<snapshot::Term> terms;
+    string data;
+
+    Index Add(TermPtr t);
+    bool Contains(TermPtr t) const { return index_of.count(t) > 0; }
+    Index IndexOf(TermPtr t) const
+    {
+        auto it = index_of.find(t);
+        return it == index_of.end() ? kNoTerm : it->second;
+    }
+    Span AddString(string_view s)
+    {
+        Span span{uint32_t(data.size()), uint32_t(s.size())};
+        data.append(s);
+        return span;
+    }
+    // `n_entries` entries of `xs.size() / n_entries` items each.
+    Span AddList(const vector<uint32_t>& xs, size_t n_entries)
+    {
+        while (data.size() % sizeof(uint32_t) != 0) {
+            data.push_back('\0');
+        }
+        Span span{uint32_t(data.size()), uint32_t(n_entries)};
+        data.append(reinterpret_cast<const char*>(xs.data()), xs.size() * sizeof(uint32_t));
+        return span;
+    }
+    Span AddVariableSet(const unordered_set<term::Variable const*>& vs)
+    {
+        // Variables not added yet get their indices by name, not in the order of the set.
+        vector<term::Variable const*> sorted(BE(vs));
+        std::sort(BE(sorted), [](auto x, auto y) { return x->name < y->name; });
+        vector<uint32_t> xs;
+        for (auto v : sorted) {
+            xs.push_back(Add(v));
+        }
+        std::sort(BE(xs));
+        return AddList(xs, xs.size());
+    }
+    Span AddBoundVariables(const vector<BoundVariable>& bvs)
+    {
+        vector<uint32_t> xs;
+        for (auto& bv : bvs) {
+            xs.push_back(Add(bv.variable));
+            xs.push_back(Add(bv.value));
+        }
+        return AddList(xs, bvs.size());
+    }
+    Span AddNamedTerms(const unordered_map<string, TermPtr>& m)
+    {
+        vector<pair<string_view, TermPtr>> sorted(BE(m));
+        std::sort(BE(sorted));
+        vector<uint32_t> xs;
+        for (auto& [name, term] : sorted) {
+            auto index = Add(term);
+            auto span = AddString(name);
+            xs.push_back(span.offset);
+            xs.push_back(span.size);
+            xs.push_back(index);
+        }
+        return AddList(xs, sorted.size());
+    }
+
+private:
+    const Store& store;
+    unordered_map<TermPtr, Index> index_of;
+};
+
+Index SnapshotBuilder::Add(TermPtr t)
+{
+    auto it = index_of.find(t);
+    if (it != index_of.end()) {
+        return it->second;
+    }
+    using namespace term;
+    snapshot::Term r{};
+    r.tag = uint8_t(t->tag);
+    r.a = kNoTerm;
+    switch (t->tag) {
+        case Tag::Abstraction: {
+            auto u = term_cast<Abstraction>(t);
+            r.lists[0] = AddVariableSet(u->forall_variables);
+            r.lists[1] = AddBoundVariables(u->bound_variables);
+            vector<uint32_t> xs;
+            for (auto& p : u->parameters) {
+                xs.push_back(Add(p.variable));
+                xs.push_back(Add(p.expected_type));
+            }
+            r.lists[2] = AddList(xs, u->parameters.size());
+            r.a = Add(u->body);
+        } break;
+        case Tag::LetIns: {
+            auto u = term_cast<LetIns>(t);
+            r.lists[1] = AddBoundVariables(u->bound_variables);
+            r.a = Add(u->body);
+        } break;
+        case Tag::Application: {
+            auto u = term_cast<Application>(t);
+            vector<uint32_t> xs;
+            for (auto a : u->arguments) {
+                xs.push_back(Add(a));
+            }
+            r.lists[0] = AddList(xs, xs.size());
+            r.a = Add(u->function);
+        } break;
+        case Tag::Variable: {
+            auto u = term_cast<Variable>(t);
+            r.small = u->comptime;
+            r.lists[0] = AddString(u->name);
+        } break;
+        case Tag::CppTerm:
+            r.lists[0] = AddString(store.inner_function_map.at(term_cast<CppTerm>(t)->id).name);
+            break;
+        case Tag::StringLiteral:
+            r.lists[0] = AddString(term_cast<StringLiteral>(t)->value);
+            break;
+        case Tag::NumericLiteral: {
+            auto& n = term_cast<NumericLiteral>(t)->value;
+            r.small = uint8_t(n.kind);
+            int64_t xs[2] = {0, 1};
+            if (n.kind == Number::Kind::Rational) {
+                xs[0] = n.GetRational().numerator;
+                xs[1] = n.GetRational().denominator;
+            }
+            r.lists[0] = AddString(string_view(reinterpret_cast<const char*>(xs), sizeof(xs)));
+        } break;
+        case Tag::UnitLikeValue:
+            r.a = Add(term_cast<UnitLikeValue>(t)->type);
+            break;
+        case Tag::DeferredValue: {
+            auto u = term_cast<DeferredValue>(t);
+            r.small = uint8_t(u->availability);
+            r.a = Add(u->type);
+        } break;
+        case Tag::ProductValue: {
+            auto u = term_cast<ProductValue>(t);
+            r.lists[0] = AddNamedTerms(u->values);
+            r.a = Add(u->type);
+        } break;
+        case Tag::SimpleTypeTerm:
+            r.small = uint8_t(term_cast<SimpleTypeTerm>(t)->simple_type);
+            break;
+        case Tag::NamedType: {
+            auto u = term_cast<NamedType>(t);
+            r.lists[0] = AddString(u->name);
+            r.a = u->type_constructor ? Add(u->type_constructor) : kNoTerm;
+        } break;
+        case Tag::FunctionType: {
+            auto u = term_cast<FunctionType>(t);
+            r.lists[0] = AddVariableSet(u->forall_variables);
+            vector<uint32_t> xs;
+            for (auto& p : u->parameter_types) {
+                xs.push_back(Add(p.type));
+                xs.push_back(p.comptime_parameter ? Add(*p.comptime_parameter) : kNoTerm);
+            }
+            r.lists[1] = AddList(xs, u->parameter_types.size());
+            r.a = Add(u->return_type);
+        } break;
+        case Tag::TypeOfAbstraction:
+            r.a = Add(term_cast<TypeOfAbstraction>(t)->abstraction);
+            break;
+        case Tag::ProductType:
+            r.lists[0] = AddNamedTerms(term_cast<ProductType>(t)->members);
+            break;
+    }
+    auto index = Index(terms.size());
+    terms.push_back(r);
+    index_of.insert(make_pair(t, index));
+    return index;
+}
+
+template <class T>
+void Append(string& s, const T* xs, size_t n)
+{
+    s.append(reinterpret_cast<const char*>(xs), n * sizeof(T));
+}
+
+// The image of `t` and the terms it refers to, orders terms which aren't in a builder yet.
+string Fingerprint(const Store& store, TermPtr t)
+{
+    SnapshotBuilder b(store);
+    b.Add(t);
+    string s;
+    Append(s, b.terms.data(), b.terms.size());
+    return s + b.data;
+}
+
+}  // namespace
+
+namespace {
+
+bool SaveSnapshot(const Store& store,
+                  const vector<pair<string, TermPtr>>& roots,
+                  const string& path,
+                  bool all_terms)
+{
+    SnapshotBuilder b(store);
+    if (all_terms) {
+        for (auto t : store.canonical_terms) {
+            b.Add(t);
+        }
+    }
+
+    vector<pair<string, Index>> sorted_roots;
+    for (auto& [name, term] : roots) {
+        sorted_roots.emplace_back(name, term ? b.Add(term) : kNoTerm);
+    }
+    std::sort(BE(sorted_roots));
+    vector<snapshot::Root> root_records;
+    for (auto& [name, index] : sorted_roots) {
+        root_records.push_back(snapshot::Root{b.AddString(name), index});
+    }
+
+    // The values and the type of a type cache entry can be terms which have entries themselves, so
+    // entries are taken until no more terms are added. Each round takes its entries in the order of
+    // their keys, not in the order of the map, so the image depends only on the terms (and on the
+    // names of the variables, which are compared instead of their identities).
+    using TypeCacheItem = pair<const TermWithBoundFreeVariables, TermPtr>;
+    // (term, [(variable, value or kNoTerm, fingerprint of the value if it's not added yet)])
+    using SortKey = pair<Index, vector<tuple<Index, Index, string>>>;
+    vector<snapshot::TypeCacheEntry> type_cache;
+    unordered_set<const TypeCacheItem*> taken;
+    for (size_t n_terms = 0; n_terms != b.terms.size();) {
+        n_terms = b.terms.size();
+        vector<pair<SortKey, const TypeCacheItem*>> round;
+        for (auto& item : store.types_of_terms_in_context) {
+            auto term = b.IndexOf(item.first.term);
+            if (term == kNoTerm || taken.count(&item) > 0) {
+                continue;
+            }
+            SortKey key{term, {}};
+            for (auto& [variable, value] : item.first.bound_variables.variables) {
+                auto index = b.IndexOf(value);
+                key.second.emplace_back(b.IndexOf(variable), index,
+                                        index == kNoTerm ? Fingerprint(store, value) : string());
+            }
+            std::sort(BE(key.second));
+            round.emplace_back(move(key), &item);
+        }
+        std::stable_sort(BE(round), [](auto& x, auto& y) { return x.first < y.first; });
+        for (auto& [key, item] : round) {
+            taken.insert(item);
+            auto& m = item->first.bound_variables.variables;
+            vector<pair<term::Variable const*, TermPtr>> bvs(BE(m));
+            std::sort(BE(bvs), [&b](auto& x, auto& y) {
+                return b.IndexOf(x.first) < b.IndexOf(y.first);
+            });
+            vector<uint32_t> xs;
+            for (auto& [variable, value] : bvs) {
+                xs.push_back(b.Add(variable));
+                xs.push_back(b.Add(value));
+            }
+            auto type = b.Add(item->second);
+            type_cache.push_back(
+                snapshot::TypeCacheEntry{key.first, b.AddList(xs, bvs.size()), type});
+        }
+    }
+
+    // Taken after the type cache, whose entries add terms. The canonical FreeVariables are shared
+    // by the terms, so are their lists.
+    vector<pair<Index, FreeVariables const*>> sorted_free_variables;
+    for (auto& [term, fvs] : store.free_variables_of_terms) {
+        auto index = b.IndexOf(term);
+        if (index != kNoTerm) {
+            sorted_free_variables.emplace_back(index, fvs);
+        }
+    }
+    std::sort(BE(sorted_free_variables));
+    vector<snapshot::FreeVariablesOfTerm> free_variables;
+    unordered_map<FreeVariables const*, Span> span_of_set;
+    for (auto& [term, fvs] : sorted_free_variables) {
+        auto it = span_of_set.find(fvs);
+        if (it == span_of_set.end()) {
+            it = span_of_set.insert(make_pair(fvs, b.AddVariableSet(*fvs))).first;
+        }
+        free_variables.push_back(snapshot::FreeVariablesOfTerm{term, it->second});
+    }
+
+    snapshot::Header header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = snapshot::kVersion;
+    header.n_terms = uint32_t(b.terms.size());
+    header.n_roots = uint32_t(root_records.size());
+    header.n_free_variables = uint32_t(free_variables.size());
+    header.n_type_cache_entries = uint32_t(type_cache.size());
+    header.data_size = uint32_t(b.data.size());
+
+    string image;
+    image.reserve(ExpectedSize(header));
+    Append(image, &header, 1);
+    Append(image, b.terms.data(), b.terms.size());
+    Append(image, root_records.data(), root_records.size());
+    Append(image, free_variables.data(), free_variables.size());
+    Append(image, type_cache.data(), type_cache.size());
+    image += b.data;
+    assert(image.size() == ExpectedSize(header));
+
+    auto f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size();
+    return fclose(f) == 0 && ok;
+}
+
+}  // namespace
+
+bool SaveStoreSnapshot(const Store& store,
+                       const vector<pair<string, TermPtr>>& roots,
+                       const string& path)
+{
+    return SaveSnapshot(store, roots, path, true);
+}
+
+bool SaveRootsSnapshot(const Store& store,
+                       const vector<pair<string, TermPtr>>& roots,
+                       const string& path)
+{
+    return SaveSnapshot(store, roots, path, false);
+}
+
+optional<StoreSnapshot> StoreSnapshot::Load(const string& path)
+{
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+#if SNL_SNAPSHOT_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullopt;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = size_t(st.st_size);
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            base = static_cast<const uint8_t*>(p);
+            mapped = true;
+        }
+    }
+    close(fd);
+#else
+    if (auto f = fopen(path.c_str(), "rb")) {
+        fseek(f, 0, SEEK_END);
+        size = size_t(ftell(f));
+        fseek(f, 0, SEEK_SET);
+        auto buffer = new uint8_t[size];
+        if (fread(buffer, 1, size, f) == size) {
+            base = buffer;
+        } else {
+            delete[] buffer;
+        }
+        fclose(f);
+    }
+#endif
+    if (!base) {
+        return nullopt;
+    }
+    StoreSnapshot snapshot(base, size, mapped);
+    auto& h = snapshot.header();
+    if (size < sizeof(snapshot::Header) || memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+        h.version != snapshot::kVersion || ExpectedSize(h) != size) {
+        return nullopt;
+    }
+    snapshot.materialized.assign(h.n_terms, nullptr);
+    return optional<StoreSnapshot>(move(snapshot));
+}
+
+StoreSnapshot::StoreSnapshot(const uint8_t* base, size_t size, bool mapped)
+    : base(base), size(size), mapped(mapped)
+{}
+
+StoreSnapshot::StoreSnapshot(StoreSnapshot&& y)
+    : base(y.base), size(y.size), mapped(y.mapped), materialized(move(y.materialized))
+{
+    y.base = nullptr;
+}
+
+StoreSnapshot::~StoreSnapshot()
+{
+    if (!base) {
+        return;
+    }
+#if SNL_SNAPSHOT_HAS_MMAP
+    if (mapped) {
+        munmap(const_cast<uint8_t*>(base), size);
+        return;
+    }
+#endif
+    delete[] base;
+}
+
+const snapshot::Term* StoreSnapshot::terms() const
+{
+    return reinterpret_cast<const snapshot::Term*>(base + sizeof(snapshot::Header));
+}
+
+const snapshot::Root* StoreSnapshot::roots() const
+{
+    return reinterpret_cast<const snapshot::Root*>(terms() + header().n_terms);
+}
+
+const snapshot::FreeVariablesOfTerm* StoreSnapshot::free_variables() const
+{
+    return reinterpret_cast<const snapshot::FreeVariablesOfTerm*>(roots() + header().n_roots);
+}
+
+const snapshot::TypeCacheEntry* StoreSnapshot::type_cache() const
+{
+    return reinterpret_cast<const snapshot::TypeCacheEntry*>(free_variables() +
+                                                             header().n_free_variables);
+}
+
+const uint8_t* StoreSnapshot::data() const
+{
+    return reinterpret_cast<const uint8_t*>(type_cache() + header().n_type_cache_entries);
+}
+
+string_view StoreSnapshot::String(Span span) const
+{
+    assert(span.offset + span.size <= header().data_size);
+    return string_view(reinterpret_cast<const char*>(data()) + span.offset, span.size);
+}
+
+uint32_t StoreSnapshot::ListItem(Span span, uint32_t i) const
+{
+    uint32_t x;
+    memcpy(&x, data() + span.offset + i * sizeof(uint32_t), sizeof(x));
+    return x;
+}
+
+optional<Index> StoreSnapshot::FindRoot(string_view name) const
+{
+    auto first = roots();
+    auto last = first + header().n_roots;
+    auto it = std::lower_bound(first, last, name, [this](const snapshot::Root& r, string_view n) {
+        return String(r.name) < n;
+    });
+    if (it == last || String(it->name) != name) {
+        return nullopt;
+    }
+    return it->term;
+}
+
+TermPtr StoreSnapshot::Materialize(Store& store, Index index)
+{
+    assert(index < header().n_terms);
+    auto& p = materialized[index];
+    if (!p) {
+        p = BuildTerm(store, terms()[index]);
+    }
+    return p;
+}
+
+TermPtr StoreSnapshot::BuildTerm(Store& store, const snapshot::Term& r)
+{
+    using namespace term;
+    auto term_at = [this, &store](Index i) { return Materialize(store, i); };
+    auto variable_at = [&term_at](Index i) { return term_cast<Variable>(term_at(i)); };
+    auto variable_set = [this, &variable_at](Span span) {
+        unordered_set<Variable const*> vs;
+        for (uint32_t i = 0; i < span.size; ++i) {
+            vs.insert(variable_at(ListItem(span, i)));
+        }
+        return vs;
+    };
+    auto bound_variables = [this, &term_at, &variable_at](Span span) {
+        vector<BoundVariable> bvs;
+        for (uint32_t i = 0; i < span.size; ++i) {
+            bvs.push_back(BoundVariable{variable_at(ListItem(span, 2 * i)),
+                                        term_at(ListItem(span, 2 * i + 1))});
+        }
+        return bvs;
+    };
+    auto named_terms = [this, &term_at](Span span) {
+        unordered_map<string, TermPtr> m;
+        for (uint32_t i = 0; i < span.size; ++i) {
+            auto name = String(Span{ListItem(span, 3 * i), ListItem(span, 3 * i + 1)});
+            m.insert(make_pair(string(name), term_at(ListItem(span, 3 * i + 2))));
+        }
+        return m;
+    };
+
+    switch (Tag(r.tag)) {
+        case Tag::Abstraction: {
+            vector<Parameter> parameters;
+            for (uint32_t i = 0; i < r.lists[2].size; ++i) {
+                parameters.emplace_back(variable_at(ListItem(r.lists[2], 2 * i)),
+                                        term_at(ListItem(r.lists[2], 2 * i + 1)));
+            }
+            return store.MakeCanonical(Abstraction(
+                Abstraction::UncheckedConstructor{}, variable_set(r.lists[0]),
+                bound_variables(r.lists[1]), move(parameters), term_at(r.a)));
+        }
+        case Tag::LetIns:
+            return store.MakeCanonical(LetIns(bound_variables(r.lists[1]), term_at(r.a)));
+        case Tag::Application: {
+            vector<TermPtr> arguments;
+            for (uint32_t i = 0; i < r.lists[0].size; ++i) {
+                arguments.push_back(term_at(ListItem(r.lists[0], i)));
+            }
+            return store.MakeCanonical(Application(term_at(r.a), move(arguments)));
+        }
+        case Tag::Variable:
+            return store.MakeNewVariable(r.small != 0, string(String(r.lists[0])));
+        case Tag::CppTerm: {
+            auto name = String(r.lists[0]);
+            auto it = std::find_if(BE(store.inner_function_map),
+                                   [name](auto& p) { return p.second.name == name; });
+            // Only the functions which every Store defines can be rebuilt.
+            ASSERT_ELSE(it != store.inner_function_map.end(), return nullptr;);
+            return store.MakeCanonical(CppTerm(it->first));
+        }
+        case Tag::StringLiteral:
+            return store.MakeCanonical(StringLiteral(string(String(r.lists[0]))));
+        case Tag::NumericLiteral: {
+            int64_t xs[2];
+            memcpy(xs, String(r.lists[0]).data(), sizeof(xs));
+            // Number can only be constructed from an integer.
+            ASSERT_ELSE(Number::Kind(r.small) == Number::Kind::Rational && xs[1] == 1,
+                        return nullptr;);
+            return store.MakeCanonical(NumericLiteral(Number(xs[0])));
+        }
+        case Tag::UnitLikeValue:
+            return store.MakeCanonical(UnitLikeValue(term_at(r.a)));
+        case Tag::DeferredValue:
+            return store.MakeCanonical(
+                DeferredValue(term_at(r.a), DeferredValue::Availability(r.small)));
+        case Tag::ProductValue:
+            return store.MakeCanonical(ProductValue(term_at(r.a), named_terms(r.lists[0])));
+        case Tag::SimpleTypeTerm:
+            return store.MakeCanonical(SimpleTypeTerm(SimpleType(r.small)));
+        case Tag::NamedType:
+            return store.MakeCanonical(NamedType(string(String(r.lists[0])),
+                                                 r.a == kNoTerm ? nullptr : term_at(r.a)));
+        case Tag::FunctionType: {
+            vector<TypeAndAvailability> parameter_types;
+            for (uint32_t i = 0; i < r.lists[1].size; ++i) {
+                auto comptime_parameter = ListItem(r.lists[1], 2 * i + 1);
+                parameter_types.emplace_back(
+                    term_at(ListItem(r.lists[1], 2 * i)),
+                    comptime_parameter == kNoTerm ? nullopt
+                                                  : make_optional(variable_at(comptime_parameter)));
+            }
+            return store.MakeCanonical(
+                FunctionType(variable_set(r.lists[0]), move(parameter_types), term_at(r.a)));
+        }
+        case Tag::TypeOfAbstraction:
+            return store.MakeCanonical(TypeOfAbstraction(term_cast<Abstraction>(term_at(r.a))));
+        case Tag::ProductType:
+            return store.MakeCanonical(ProductType(named_terms(r.lists[0])));
+    }
+    UNREACHABLE;
+    return nullptr;
+}
+
+void StoreSnapshot::MaterializeAll(Store& store)
+{
+    auto& h = header();
+    for (Index i = 0; i < h.n_terms; ++i) {
+        Materialize(store, i);
+    }
+    for (uint32_t i = 0; i < h.n_free_variables; ++i) {
+        auto& e = free_variables()[i];
+        FreeVariables fvs;
+        for (uint32_t j = 0; j < e.variables.size; ++j) {
+            fvs.insert(term_cast<term::Variable>(materialized[ListItem(e.variables, j)]));
+        }
+        // Through the Store so that a rolled back checkpoint takes the entries back too.
+        store.GetOrInsertFreeVariablesOfTerm(materialized[e.term], [&fvs] { return move(fvs); });
+    }
+    for (uint32_t i = 0; i < h.n_type_cache_entries; ++i) {
+        auto& e = type_cache()[i];
+        BoundVariables bvs;
+        for (uint32_t j = 0; j < e.bound_variables.size; ++j) {
+            bvs.variables.insert(make_pair(
+                term_cast<term::Variable>(materialized[ListItem(e.bound_variables, 2 * j)]),
+                materialized[ListItem(e.bound_variables, 2 * j + 1)]));
+        }
+        store.GetOrInsertTypeOfTermInContext(
+            TermWithBoundFreeVariables(materialized[e.term], move(bvs)),
+            [type = materialized[e.type]]() -> optional<TermPtr> { return type; });
+    }
+}
+
+}  // namespace snl
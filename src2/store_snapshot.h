@@ -0,0 +1,134 @@
+#pragma once
+
+#include "common.h"
+#include "store.h"
+
+#include <cstdint>
+
+namespace snl {
+
+// Binary image of a Store: its terms, the free variables of the terms, the type cache and named
+// roots (e.g. the top-level bindings of a module). Records refer to terms by index and to lists and
+// strings by offsets into the data section, so the image has no pointers and is used directly
+// from the mapped file.
+//
+// Layout:
+//   snapshot::Header
+//   snapshot::Term[n_terms]                 Post-order, a term comes after the terms it refers to.
+//   snapshot::Root[n_roots]                 Sorted by name.
+//   snapshot::FreeVariablesOfTerm[n_free_variables]
+//   snapshot::TypeCacheEntry[n_type_cache_entries]
+//   data[data_size]                         Lists of uint32_t and strings.
+namespace snapshot {
+
+using Index = uint32_t;  // Index of a Term.
+constexpr Index kNoTerm = UINT32_MAX;
+constexpr uint32_t kVersion = 2;
+
+struct Span
+{
+    uint32_t offset = 0;  // Into the data section.
+    uint32_t size = 0;    // Number of bytes for strings, number of entries for lists.
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t n_terms;
+    uint32_t n_roots;
+    uint32_t n_free_variables;
+    uint32_t n_type_cache_entries;
+    uint32_t data_size;
+};
+
+// Meaning of the fields depends on the tag, see store_snapshot.cpp.
+struct Term
+{
+    uint8_t tag;
+    uint8_t small;  // Variable::comptime, DeferredValue::availability, SimpleType, Number::kind.
+    uint16_t unused;
+    Index a;
+    Span lists[3];
+};
+
+struct Root
+{
+    Span name;
+    Index term;
+};
+
+struct FreeVariablesOfTerm
+{
+    Index term;
+    Span variables;  // Index list. Terms with the same set share the list.
+};
+
+struct TypeCacheEntry
+{
+    Index term;
+    Span bound_variables;  // (variable, value) index pairs.
+    Index type;
+};
+
+}  // namespace snapshot
+
+// Writes the terms of `store` with everything needed to rebuild them, `roots` can be looked up by
+// name after loading. A root may be nullptr to record only a name.
+bool SaveStoreSnapshot(const Store& store,
+                       const vector<pair<string, TermPtr>>& roots,
+                       const string& path);
+// Like SaveStoreSnapshot but writes only the terms reachable from `roots`, and the free variables
+// and type cache entries of those terms.
+bool SaveRootsSnapshot(const Store& store,
+                       const vector<pair<string, TermPtr>>& roots,
+                       const string& path);
+
+// A snapshot mapped read-only into memory. Loading validates only the header, terms are built in a
+// Store when they're first asked for.
+class StoreSnapshot
+{
+public:
+    static optional<StoreSnapshot> Load(const string& path);
+
+    StoreSnapshot(StoreSnapshot&& y);
+    StoreSnapshot& operator=(StoreSnapshot&&) = delete;
+    StoreSnapshot(const StoreSnapshot&) = delete;
+    ~StoreSnapshot();
+
+    uint32_t NumTerms() const { return header().n_terms; }
+    uint32_t NumRoots() const { return header().n_roots; }
+    string_view RootName(uint32_t i) const { return String(roots()[i].name); }
+    snapshot::Index RootTerm(uint32_t i) const { return roots()[i].term; }  // Can be kNoTerm.
+    optional<snapshot::Index> FindRoot(string_view name) const;
+
+    // Builds the term and the terms it refers to in `store`, each only once. Always pass the same
+    // Store.
+    TermPtr Materialize(Store& store, snapshot::Index index);
+    // Builds all terms and fills the free variables and the type cache of `store`, which a rolled
+    // back checkpoint takes back like any other entries.
+    void MaterializeAll(Store& store);
+
+private:
+    StoreSnapshot(const uint8_t* base, size_t size, bool mapped);
+
+    const uint8_t* base;
+    size_t size;
+    bool mapped;  // Otherwise `base` was allocated with new[].
+    vector<TermPtr> materialized;  // By index, nullptr if not yet built.
+
+    const snapshot::Header& header() const
+    {
+        return *reinterpret_cast<const snapshot::Header*>(base);
+    }
+    const snapshot::Term* terms() const;
+    const snapshot::Root* roots() const;
+    const snapshot::FreeVariablesOfTerm* free_variables() const;
+    const snapshot::TypeCacheEntry* type_cache() const;
+    const uint8_t* data() const;
+    string_view String(snapshot::Span span) const;
+    uint32_t ListItem(snapshot::Span span, uint32_t i) const;
+    TermPtr BuildTerm(Store& store, const snapshot::Term& t);
+};
+
+}  // namespace snl
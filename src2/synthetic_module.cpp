@@ -0,0 +1,128 @@
+#include "synthetic_module.h"
+
+#include <random>
+
+#include "store.h"
+
+namespace snl {
+
+namespace {
+
+class SyntheticModuleBuilder
+{
+public:
+    SyntheticModuleBuilder(Store& store, const SyntheticModuleShape& shape)
+        : store(store), shape(shape), rng(shape.seed)
+    {}
+
+    Module Build()
+    {
+        for (int i = 0; i < shape.n_polymorphic_functions; ++i) {
+            polymorphic_functions.push_back(
+                MakePolymorphicFunction(shape.n_forall_variables, i % shape.n_forall_variables));
+            Bind(fmt::format("poly#{}", i), polymorphic_functions.back());
+        }
+        for (int i = 0; i < shape.n_shared_terms; ++i) {
+            shared_terms.push_back(MakeSharedTerm(i));
+        }
+        auto wide_function = MakePolymorphicFunction(shape.application_width, 0);
+        Bind("wide_function", wide_function);
+        for (int i = 0; i < shape.n_wide_applications; ++i) {
+            vector<TermPtr> arguments;
+            for (int j = 0; j < shape.application_width; ++j) {
+                arguments.push_back(SharedTerm());
+            }
+            Bind(fmt::format("wide#{}", i), MC(term::Application(wide_function, move(arguments))));
+        }
+        for (int i = 0; i < shape.n_let_in_chains; ++i) {
+            Bind(fmt::format("chain#{}", i), MakeLetInChain());
+        }
+        return Module(move(statements));
+    }
+
+private:
+    Store& store;
+    const SyntheticModuleShape& shape;
+    // mt19937 output is the same everywhere, unlike the library distributions.
+    std::mt19937 rng;
+    vector<TermPtr> polymorphic_functions;
+    vector<TermPtr> shared_terms;
+    vector<ModuleStatement> statements;
+
+    TermPtr MC(Term&& term) { return store.MakeCanonical(move(term)); }
+    int Uniform(int n) { return int(rng() % uint32_t(n)); }
+    TermPtr SharedTerm() { return shared_terms[Uniform(int(shared_terms.size()))]; }
+
+    void Bind(string&& name, TermPtr term)
+    {
+        statements.push_back(TopLevelBinding{move(name), term});
+    }
+
+    // forall T1..Tn, (x1: T1, ..., xn: Tn) -> x_result.
+    TermPtr MakePolymorphicFunction(int n_parameters, int result)
+    {
+        unordered_set<term::Variable const*> forall_variables;
+        vector<Parameter> parameters;
+        for (int j = 0; j < n_parameters; ++j) {
+            auto type_variable = store.MakeNewVariable(true);
+            forall_variables.insert(type_variable);
+            parameters.push_back(Parameter(store.MakeNewVariable(false), type_variable));
+        }
+        auto body = parameters[result].variable;
+        auto abstraction = term::Abstraction::MakeAbstraction(
+            store, move(forall_variables), vector<BoundVariable>(), move(parameters), body);
+        ASSERT_ELSE(abstraction, return store.unit_type;);
+        return MC(move(*abstraction));
+    }
+
+    // The first half are literals, the others apply polymorphic functions to earlier shared terms.
+    TermPtr MakeSharedTerm(int i)
+    {
+        if (i < (shape.n_shared_terms + 1) / 2) {
+            return MC(term::StringLiteral(fmt::format("shared#{}", i)));
+        }
+        vector<TermPtr> arguments;
+        for (int j = 0; j < shape.n_forall_variables; ++j) {
+            arguments.push_back(SharedTerm());
+        }
+        return MC(term::Application(PolymorphicFunction(), move(arguments)));
+    }
+
+    TermPtr PolymorphicFunction()
+    {
+        return polymorphic_functions[Uniform(int(polymorphic_functions.size()))];
+    }
+
+    // let v0 = shared, v1 = poly(v0, shared...), ... in v_last
+    TermPtr MakeLetInChain()
+    {
+        vector<BoundVariable> bound_variables;
+        TermPtr previous = SharedTerm();
+        for (int d = 0; d < shape.let_in_depth; ++d) {
+            TermPtr value = previous;
+            if (d > 0) {
+                vector<TermPtr> arguments{previous};
+                for (int j = 1; j < shape.n_forall_variables; ++j) {
+                    arguments.push_back(SharedTerm());
+                }
+                value = MC(term::Application(PolymorphicFunction(), move(arguments)));
+            }
+            auto variable = store.MakeNewVariable(false);
+            bound_variables.push_back(BoundVariable{variable, value});
+            previous = variable;
+        }
+        return MC(term::LetIns(move(bound_variables), previous));
+    }
+};
+
+}  // namespace
+
+Module MakeSyntheticModule(Store& store, const SyntheticModuleShape& shape)
+{
+    ASSERT_ELSE(shape.n_polymorphic_functions > 0 && shape.n_forall_variables > 0 &&
+                    shape.application_width > 0 && shape.n_shared_terms > 0,
+                return Module(vector<ModuleStatement>()););
+    return SyntheticModuleBuilder(store, shape).Build();
+}
+
+}  // namespace snl
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "module.h"
+#include "term.h"
+
+namespace snl {
+
+// Shape of a generated module, for benchmarking the term engine on inputs larger than the
+// hand-written samples. The same shape and seed give the same module.
+struct SyntheticModuleShape
+{
+    // Top-level polymorphic functions: forall T1..Tn, (x1: T1, ..., xn: Tn) returning one of them.
+    int n_polymorphic_functions = 64;
+    int n_forall_variables = 3;
+    // Top-level LetIns chains, each bound variable is an application of a polymorphic function to
+    // the previous one.
+    int n_let_in_chains = 16;
+    int let_in_depth = 256;
+    // Top-level applications of a polymorphic function of `application_width` parameters.
+    int n_wide_applications = 64;
+    int application_width = 64;
+    // Literals and applications used as the arguments everywhere, so they are heavily shared.
+    int n_shared_terms = 32;
+    uint32_t seed = 1;
+};
+
+// Builds the terms through Store::MakeCanonical. The bindings are named "poly#i", "wide_function",
+// "wide#i" and "chain#i".
+Module MakeSyntheticModule(Store& store, const SyntheticModuleShape& shape);
+
+}  // namespace snl
@@ -13,7 +13,9 @@ optional<Abstraction> Abstraction::MakeAbstraction(
 {
     ASSERT_ELSE(!parameters.empty(), return nullopt;);
     auto bound_variables_so_far = *GetFreeVariables(store, body);
-    bound_variables_so_far.erase(BE(forall_variables));
+    for (auto v : forall_variables) {
+        bound_variables_so_far.erase(v);
+    }
     for (auto bv : bound_variables) {
         bound_variables_so_far.erase(bv.variable);
     }
@@ -242,7 +244,7 @@ std::size_t TermHash::operator()(TermPtr t) const noexcept
             MAKE_U(NamedType);
             HC(u.name);
             HC(u.type_constructor);
-        }
+        } break;
         case Tag::FunctionType: {
             MAKE_U(FunctionType);
             hash_range(h, BE(u.parameter_types));
@@ -166,6 +166,7 @@ public:
                 vector<Parameter>&& parameters,
                 TermPtr body)
         : Term(Tag::Abstraction),
+          forall_variables(move(forall_variables)),
           bound_variables(move(bound_variables)),
           parameters(move(parameters)),
           body(body)
@@ -177,6 +178,7 @@ private:
                 vector<Parameter>&& parameters,
                 TermPtr body)
         : Term(Tag::Abstraction),
+          forall_variables(move(forall_variables)),
           bound_variables(move(bound_variables)),
           parameters(move(parameters)),
           body(body)
@@ -260,11 +262,12 @@ struct SimpleTypeTerm : TypeTerm
 struct NamedType : TypeTerm
 {
     STATIC_TAG(NamedType);
-    SimpleType simple_type;
     string name;               // For debugging.
     TermPtr type_constructor;  // Either a type (nullary ctor) or an application
     explicit NamedType(string&& name, TermPtr type_constructor)
-        : TypeTerm(Tag::NamedType), simple_type(simple_type)
+        : TypeTerm(Tag::NamedType),
+          name(move(name)),
+          type_constructor(type_constructor)
     {}
 };
 
@@ -351,6 +354,90 @@ T const* term_cast(TermPtr p)
 // Visitor should return true to abort the traversal.
 void DepthFirstTraversal(TermPtr p, std::function<bool(TermPtr)>& f);
 */
+
+// Calls f(TermPtr) for each term `t` refers to directly, including the variables it introduces, in
+// the order they appear in `t`. A subterm referred to more than once is visited for each reference.
+template <class F>
+void ForEachSubterm(TermPtr t, F&& f)
+{
+    using namespace term;
+    auto bound_variables = [&f](const vector<BoundVariable>& bvs) {
+        for (auto& bv : bvs) {
+            f(bv.variable);
+            f(bv.value);
+        }
+    };
+    auto named_terms = [&f](const unordered_map<string, TermPtr>& m) {
+        for (auto& [name, u] : m) {
+            f(u);
+        }
+    };
+    switch (t->tag) {
+        case Tag::Abstraction: {
+            auto u = term_cast<Abstraction>(t);
+            for (auto v : u->forall_variables) {
+                f(v);
+            }
+            bound_variables(u->bound_variables);
+            for (auto& p : u->parameters) {
+                f(p.variable);
+                f(p.expected_type);
+            }
+            f(u->body);
+        } break;
+        case Tag::LetIns: {
+            auto u = term_cast<LetIns>(t);
+            bound_variables(u->bound_variables);
+            f(u->body);
+        } break;
+        case Tag::Application: {
+            auto u = term_cast<Application>(t);
+            f(u->function);
+            for (auto a : u->arguments) {
+                f(a);
+            }
+        } break;
+        case Tag::Variable:
+        case Tag::CppTerm:
+        case Tag::StringLiteral:
+        case Tag::NumericLiteral:
+        case Tag::SimpleTypeTerm:
+            break;
+        case Tag::UnitLikeValue:
+        case Tag::DeferredValue:
+            f(static_cast<ValueTerm const*>(t)->type);
+            break;
+        case Tag::ProductValue: {
+            auto u = term_cast<ProductValue>(t);
+            f(u->type);
+            named_terms(u->values);
+        } break;
+        case Tag::NamedType:
+            if (auto c = term_cast<NamedType>(t)->type_constructor) {
+                f(c);
+            }
+            break;
+        case Tag::FunctionType: {
+            auto u = term_cast<FunctionType>(t);
+            for (auto v : u->forall_variables) {
+                f(v);
+            }
+            for (auto& p : u->parameter_types) {
+                f(p.type);
+                if (p.comptime_parameter) {
+                    f(*p.comptime_parameter);
+                }
+            }
+            f(u->return_type);
+        } break;
+        case Tag::TypeOfAbstraction:
+            f(term_cast<TypeOfAbstraction>(t)->abstraction);
+            break;
+        case Tag::ProductType:
+            named_terms(term_cast<ProductType>(t)->members);
+            break;
+    }
+}
 // bool IsTypeInNormalForm(TermPtr p);
 
 struct TermHash
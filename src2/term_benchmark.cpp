@@ -0,0 +1,128 @@
+#include "term_benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "astops.h"
+#include "eval_profiler.h"
+#include "freevariablesofterm.h"
+#include "store.h"
+#include "term_printer.h"
+#include "util/timing.h"
+
+namespace snl {
+
+namespace {
+
+struct PhaseResult
+{
+    explicit PhaseResult(const char* name) : name(name) {}
+
+    const char* name;
+    vector<int64_t> durations_ns;  // One for each repetition.
+    int n_failed = 0;              // In the last repetition.
+
+    int64_t MedianNs() const
+    {
+        auto xs = durations_ns;
+        std::sort(BE(xs));
+        return xs[xs.size() / 2];
+    }
+};
+
+template <class F>
+void RunPhase(PhaseResult& result, const Module& module, F&& f)
+{
+    result.n_failed = 0;
+    auto begin_ns = forrest::timing_now_ns();
+    for (auto& statement : module.statements) {
+        if (auto* tlb = std::get_if<TopLevelBinding>(&statement)) {
+            if (!f(tlb->term)) {
+                ++result.n_failed;
+            }
+        }
+    }
+    result.durations_ns.push_back(forrest::timing_now_ns() - begin_ns);
+}
+
+}  // namespace
+
+bool RunTermBenchmark(const SyntheticModuleShape& shape, int repetitions, const string& json_path)
+{
+    ASSERT_ELSE(repetitions > 0, return false;);
+    PhaseResult build{"MakeSyntheticModule"};
+    PhaseResult free_variables{"GetFreeVariables"};
+    PhaseResult infer_type{"InferTypeOfTerm"};
+    PhaseResult evaluate{"EvaluateTerm"};
+    PhaseResult compile{"CompileTerm"};
+    PhaseResult print{"FormatTermDag"};
+    size_t n_bindings = 0;
+    size_t n_terms = 0;
+    for (int r = 0; r < repetitions; ++r) {
+        Store store;
+        auto begin_ns = forrest::timing_now_ns();
+        auto module = MakeSyntheticModule(store, shape);
+        build.durations_ns.push_back(forrest::timing_now_ns() - begin_ns);
+        if (g_eval_profiler_enabled) {
+            // The profile is of the last repetition, the terms of the others are gone.
+            EnableEvalProfiler();
+            SetEvalProfilerNames(module);
+        }
+        n_bindings = module.statements.size();
+        n_terms = store.canonical_terms.size();
+
+        Context context(nullptr);
+        RunPhase(free_variables, module,
+                 [&](TermPtr term) { return GetFreeVariables(store, term) != nullptr; });
+        RunPhase(infer_type, module, [&](TermPtr term) {
+            return InferTypeOfTerm(store, context, term).has_value();
+        });
+        RunPhase(evaluate, module,
+                 [&](TermPtr term) { return EvaluateTerm(store, context, term).has_value(); });
+        RunPhase(compile, module,
+                 [&](TermPtr term) { return CompileTerm(store, context, term).has_value(); });
+        RunPhase(print, module, [](TermPtr term) { return !FormatTermDag(term).empty(); });
+    }
+
+    const PhaseResult* phases[] = {&build,    &free_variables, &infer_type,
+                                   &evaluate, &compile,        &print};
+    fmt::print("{} bindings, {} canonical terms, median of {} repetitions\n", n_bindings, n_terms,
+               repetitions);
+    fmt::print("{:<20} {:>12} {:>14} {:>8}\n", "phase", "ms", "ns/term", "failed");
+    for (auto p : phases) {
+        auto ns = p->MedianNs();
+        fmt::print("{:<20} {:>12.3f} {:>14.1f} {:>8}\n", p->name, ns / 1e6,
+                   double(ns) / std::max<size_t>(n_terms, 1), p->n_failed);
+    }
+
+    if (json_path.empty()) {
+        return true;
+    }
+    auto f = fopen(json_path.c_str(), "w");
+    if (!f) {
+        fmt::print(stderr, "Can't open {} for writing.\n", json_path);
+        return false;
+    }
+    fmt::print(f,
+               "{{\"shape\":{{\"n_polymorphic_functions\":{},\"n_forall_variables\":{},"
+               "\"n_let_in_chains\":{},\"let_in_depth\":{},\"n_wide_applications\":{},"
+               "\"application_width\":{},\"n_shared_terms\":{},\"seed\":{}}},\n"
+               "\"repetitions\":{},\"bindings\":{},\"terms\":{},\n\"phases\":[\n",
+               shape.n_polymorphic_functions, shape.n_forall_variables, shape.n_let_in_chains,
+               shape.let_in_depth, shape.n_wide_applications, shape.application_width,
+               shape.n_shared_terms, shape.seed, repetitions, n_bindings, n_terms);
+    for (size_t i = 0; i < std::size(phases); ++i) {
+        fmt::print(f, "{{\"name\":\"{}\",\"median_ns\":{},\"failed\":{}}}{}\n", phases[i]->name,
+                   phases[i]->MedianNs(), phases[i]->n_failed,
+                   i + 1 < std::size(phases) ? "," : "");
+    }
+    fmt::print(f, "]}}\n");
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        fmt::print(stderr, "Error writing {}.\n", json_path);
+    }
+    return ok;
+}
+
+}  // namespace snl
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "common.h"
+#include "synthetic_module.h"
+
+namespace snl {
+
+// Builds the synthetic module in a new Store `repetitions` times and runs GetFreeVariables,
+// InferTypeOfTerm, EvaluateTerm and CompileTerm on all of its top-level bindings, in this order
+// (the later phases use the free variables and types cached by the earlier ones). Prints the
+// median time of each phase and the number of failed calls to stdout and, if `json_path` is not
+// empty, writes them as JSON. Returns false if writing the JSON fails.
+bool RunTermBenchmark(const SyntheticModuleShape& shape, int repetitions, const string& json_path);
+
+}  // namespace snl
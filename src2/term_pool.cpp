@@ -0,0 +1,114 @@
+#include "term_pool.h"
+
+#include <algorithm>
+
+namespace snl {
+
+SlabPool::SlabPool(size_t object_size) : object_size(object_size)
+{
+    assert(object_size >= sizeof(void*) && object_size <= kSlabSize);
+}
+
+SlabPool::~SlabPool()
+{
+    for (auto p : slabs) {
+        ::operator delete(p);
+    }
+}
+
+void SlabPool::AddSlab()
+{
+    slabs.push_back(::operator new(kSlabSize));
+    next = static_cast<char*>(slabs.back());
+    end = next + kSlabSize / object_size * object_size;
+}
+
+SlabPool::Stats SlabPool::GetStats() const
+{
+    return Stats{object_size, slabs.size(), slabs.size() * (kSlabSize / object_size), live};
+}
+
+#define FOR_EACH_TERM_TYPE(X) \
+    X(Abstraction)            \
+    X(LetIns)                 \
+    X(Application)            \
+    X(Variable)               \
+    X(CppTerm)                \
+    X(StringLiteral)          \
+    X(NumericLiteral)         \
+    X(UnitLikeValue)          \
+    X(DeferredValue)          \
+    X(ProductValue)           \
+    X(SimpleTypeTerm)         \
+    X(NamedType)              \
+    X(FunctionType)           \
+    X(TypeOfAbstraction)      \
+    X(ProductType)
+
+namespace {
+const char* TagName(term::Tag tag)
+{
+    switch (tag) {
+#define CASE(X)        \
+    case term::Tag::X: \
+        return #X;
+        FOR_EACH_TERM_TYPE(CASE)
+#undef CASE
+    }
+    return "?";
+}
+}  // namespace
+
+TermPools::TermPools()
+{
+    using namespace term;
+    size_t n_tags = 0;
+#define COUNT(X) n_tags = std::max(n_tags, size_t(Tag::X) + 1);
+    FOR_EACH_TERM_TYPE(COUNT)
+#undef COUNT
+    pools.resize(n_tags);
+#define MAKE_POOL(X) pools[size_t(Tag::X)] = make_unique<SlabPool>(sizeof(X));
+    FOR_EACH_TERM_TYPE(MAKE_POOL)
+#undef MAKE_POOL
+}
+
+void TermPools::Delete(TermPtr term)
+{
+    using namespace term;
+    switch (term->tag) {
+#define CASE(X)                                               \
+    case Tag::X:                                              \
+        static_cast<X const*>(term)->~X();                    \
+        pools[size_t(Tag::X)]->Free(const_cast<Term*>(term)); \
+        break;
+        FOR_EACH_TERM_TYPE(CASE)
+#undef CASE
+    }
+}
+
+vector<pair<term::Tag, SlabPool::Stats>> TermPools::GetStats() const
+{
+    vector<pair<term::Tag, SlabPool::Stats>> stats;
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (pools[i]) {
+            stats.emplace_back(term::Tag(i), pools[i]->GetStats());
+        }
+    }
+    return stats;
+}
+
+void PrintTermPoolStats(FILE* f, const TermPools& term_pools)
+{
+    fmt::print(f, "{:<20} {:>6} {:>10} {:>10} {:>7} {:>6} {:>10}\n", "term pool", "size", "live",
+               "capacity", "occup.", "slabs", "KB");
+    for (auto& [tag, s] : term_pools.GetStats()) {
+        if (s.slabs == 0) {
+            continue;
+        }
+        fmt::print(f, "{:<20} {:>6} {:>10} {:>10} {:>6.1f}% {:>6} {:>10}\n", TagName(tag),
+                   s.object_size, s.live, s.capacity, 100.0 * s.live / s.capacity, s.slabs,
+                   s.slabs * SlabPool::kSlabSize / 1024);
+    }
+}
+
+}  // namespace snl
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common.h"
+#include "term.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <new>
+
+namespace snl {
+
+// Fixed-size objects carved from slabs. Freed objects are reused through an intrusive free list,
+// the slabs are released when the pool is destroyed.
+class SlabPool
+{
+public:
+    static const size_t kSlabSize = 65536;
+
+    struct Stats
+    {
+        size_t object_size = 0;
+        size_t slabs = 0;
+        size_t capacity = 0;  // Objects fitting in the slabs.
+        size_t live = 0;
+    };
+
+    explicit SlabPool(size_t object_size = sizeof(void*));
+    ~SlabPool();
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    void* Allocate()
+    {
+        ++live;
+        if (free_list) {
+            auto p = free_list;
+            free_list = *static_cast<void**>(p);
+            return p;
+        }
+        if (next == end) {
+            AddSlab();
+        }
+        auto p = next;
+        next += object_size;
+        return p;
+    }
+    void Free(void* p)
+    {
+        assert(live > 0);
+        --live;
+        *static_cast<void**>(p) = free_list;
+        free_list = p;
+    }
+
+    Stats GetStats() const;
+
+private:
+    size_t object_size;
+    vector<void*> slabs;
+    char* next = nullptr;
+    char* end = nullptr;  // Of the usable part of the last slab.
+    void* free_list = nullptr;
+    size_t live = 0;
+
+    void AddSlab();
+};
+
+// Storage of the terms of a Store, one pool per term::Tag so the terms of a kind are packed
+// densely.
+class TermPools
+{
+public:
+    TermPools();
+
+    template <class T, class... Args>
+    T* New(Args&&... args)
+    {
+        static_assert(sizeof(T) >= sizeof(void*) && alignof(T) <= alignof(std::max_align_t));
+        return new (pools[size_t(T::s_tag)]->Allocate()) T(std::forward<Args>(args)...);
+    }
+    // `term` must have been allocated by New().
+    void Delete(TermPtr term);
+
+    // By tag, for the tags which have a pool.
+    vector<pair<term::Tag, SlabPool::Stats>> GetStats() const;
+
+private:
+    vector<unique_ptr<SlabPool>> pools;  // Indexed by term::Tag.
+};
+
+void PrintTermPoolStats(FILE* f, const TermPools& term_pools);
+
+}  // namespace snl
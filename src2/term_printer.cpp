@@ -0,0 +1,398 @@
+#include "term_printer.h"
+
+#include <algorithm>
+
+namespace snl {
+
+namespace {
+
+uint64_t SaturatingAdd(uint64_t x, uint64_t y)
+{
+    return x > UINT64_MAX - y ? UINT64_MAX : x + y;
+}
+
+bool IsLeaf(TermPtr t)
+{
+    using Tag = term::Tag;
+    switch (t->tag) {
+        case Tag::Variable:
+        case Tag::CppTerm:
+        case Tag::StringLiteral:
+        case Tag::NumericLiteral:
+        case Tag::SimpleTypeTerm:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The terms reachable from the roots, with their numbers of references and tree sizes.
+struct TermDag
+{
+    vector<TermPtr> post_order;  // A term comes after its subterms.
+    unordered_map<TermPtr, int> n_references;
+    unordered_map<TermPtr, uint64_t> tree_sizes;
+
+    explicit TermDag(const vector<TermPtr>& roots)
+    {
+        // Iterative, the terms can be deeper than the stack.
+        vector<pair<TermPtr, bool>> stack;  // The bool is true if the subterms are done.
+        for (auto root : roots) {
+            ++n_references[root];
+            stack.emplace_back(root, false);
+            while (!stack.empty()) {
+                auto [t, subterms_done] = stack.back();
+                stack.pop_back();
+                if (subterms_done) {
+                    uint64_t size = 1;
+                    ForEachSubterm(t,
+                                   [&](TermPtr u) { size = SaturatingAdd(size, tree_sizes[u]); });
+                    tree_sizes[t] = size;
+                    post_order.push_back(t);
+                    continue;
+                }
+                if (!visited.insert(t).second) {
+                    continue;
+                }
+                stack.emplace_back(t, true);
+                ForEachSubterm(t, [&](TermPtr u) {
+                    ++n_references[u];
+                    stack.emplace_back(u, false);
+                });
+            }
+        }
+    }
+
+    bool IsShared(TermPtr t) const { return !IsLeaf(t) && n_references.at(t) > 1; }
+
+private:
+    unordered_set<TermPtr> visited;
+};
+
+TermDagStats GetStats(const TermDag& dag, const vector<TermPtr>& roots)
+{
+    TermDagStats stats;
+    stats.dag_size = dag.post_order.size();
+    for (auto root : roots) {
+        stats.tree_size = SaturatingAdd(stats.tree_size, dag.tree_sizes.at(root));
+    }
+    for (auto t : dag.post_order) {
+        if (dag.IsShared(t)) {
+            ++stats.n_shared;
+        }
+    }
+    return stats;
+}
+
+const char* SimpleTypeName(term::SimpleType simple_type)
+{
+    using term::SimpleType;
+    switch (simple_type) {
+        case SimpleType::TypeOfTypes:
+            return "Type";
+        case SimpleType::Bottom:
+            return "Bottom";
+        case SimpleType::Unit:
+            return "Unit";
+        case SimpleType::Top:
+            return "Top";
+        case SimpleType::TypeToBeInferred:
+            return "TypeToBeInferred";
+        case SimpleType::StringLiteral:
+            return "StringLiteral";
+        case SimpleType::NumericLiteral:
+            return "NumericLiteral";
+    }
+    return "?";
+}
+
+class Printer
+{
+public:
+    void AddName(TermPtr t) { names.insert(make_pair(t, fmt::format("%{}", names.size() + 1))); }
+    const string& NameOf(TermPtr t) const { return names.at(t); }
+
+    // The term itself, its shared subterms by name.
+    string Definition(TermPtr t)
+    {
+        string s;
+        Write(s, t);
+        return s;
+    }
+
+private:
+    enum class Mode
+    {
+        Write,      // The term itself.
+        Reference,  // Its name if it has one, otherwise the term itself.
+        Operand     // Like Reference, parenthesized unless it's a name or a leaf.
+    };
+    // A term, or if `term` is null the text [text_begin, text_end) of `texts`.
+    struct Piece
+    {
+        TermPtr term;
+        Mode mode;
+        size_t text_begin;
+        size_t text_end;
+    };
+
+    unordered_map<TermPtr, string> names;
+    // Pieces left to write, the next one at the back. Iterative, an unshared subterm can be deeper
+    // than the stack.
+    vector<Piece> pending;
+    vector<Piece> expansion;  // The pieces of the term being expanded, in order.
+    string texts;             // Of the pieces, cleared when the pieces are written.
+
+    void Write(string& s, TermPtr t)
+    {
+        pending.push_back(Piece{t, Mode::Write, 0, 0});
+        while (!pending.empty()) {
+            auto p = pending.back();
+            pending.pop_back();
+            if (!p.term) {
+                s.append(texts, p.text_begin, p.text_end - p.text_begin);
+                continue;
+            }
+            auto it = names.find(p.term);
+            if (p.mode != Mode::Write && it != names.end()) {
+                s += it->second;
+                continue;
+            }
+            if (p.mode == Mode::Operand && !IsLeaf(p.term)) {
+                s += '(';
+                expansion.clear();
+                Text(")");
+                expansion.push_back(Piece{p.term, Mode::Write, 0, 0});
+            } else {
+                expansion.clear();
+                Expand(p.term);
+                std::reverse(BE(expansion));
+            }
+            pending.insert(pending.end(), BE(expansion));
+        }
+        texts.clear();
+    }
+
+    void Text(string_view text)
+    {
+        auto begin = texts.size();
+        texts += text;
+        if (!expansion.empty() && !expansion.back().term && expansion.back().text_end == begin) {
+            expansion.back().text_end = texts.size();
+        } else {
+            expansion.push_back(Piece{nullptr, Mode::Write, begin, texts.size()});
+        }
+    }
+    void Reference(TermPtr t) { expansion.push_back(Piece{t, Mode::Reference, 0, 0}); }
+    void Operand(TermPtr t) { expansion.push_back(Piece{t, Mode::Operand, 0, 0}); }
+
+    void WriteForall(const unordered_set<term::Variable const*>& variables)
+    {
+        vector<string_view> sorted;
+        for (auto v : variables) {
+            sorted.push_back(v->name);
+        }
+        std::sort(BE(sorted));
+        Text("forall ");
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            Text(i ? ", " : "");
+            Text(sorted[i]);
+        }
+        Text(". ");
+    }
+    void WriteLet(const vector<BoundVariable>& bvs)
+    {
+        Text("let ");
+        for (size_t i = 0; i < bvs.size(); ++i) {
+            Text(i ? "; " : "");
+            Text(bvs[i].variable->name);
+            Text(" = ");
+            Reference(bvs[i].value);
+        }
+        Text(" in ");
+    }
+    void WriteNamedTerms(const unordered_map<string, TermPtr>& m, const char* separator)
+    {
+        vector<pair<string_view, TermPtr>> sorted(BE(m));
+        std::sort(BE(sorted));
+        Text("{");
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            Text(i ? ", " : "");
+            Text(sorted[i].first);
+            Text(separator);
+            Reference(sorted[i].second);
+        }
+        Text("}");
+    }
+
+    // Appends the pieces of `t` to `expansion`, its subterms as references or operands.
+    void Expand(TermPtr t)
+    {
+        using namespace term;
+        switch (t->tag) {
+            case Tag::Abstraction: {
+                auto u = term_cast<Abstraction>(t);
+                Text("fn ");
+                if (!u->forall_variables.empty()) {
+                    WriteForall(u->forall_variables);
+                }
+                if (!u->bound_variables.empty()) {
+                    WriteLet(u->bound_variables);
+                }
+                Text("(");
+                for (size_t i = 0; i < u->parameters.size(); ++i) {
+                    Text(i ? ", " : "");
+                    Text(u->parameters[i].variable->name);
+                    Text(": ");
+                    Reference(u->parameters[i].expected_type);
+                }
+                Text(") -> ");
+                Reference(u->body);
+            } break;
+            case Tag::LetIns: {
+                auto u = term_cast<LetIns>(t);
+                WriteLet(u->bound_variables);
+                Reference(u->body);
+            } break;
+            case Tag::Application: {
+                auto u = term_cast<Application>(t);
+                Operand(u->function);
+                Text("(");
+                for (size_t i = 0; i < u->arguments.size(); ++i) {
+                    if (i > 0) {
+                        Text(", ");
+                    }
+                    Reference(u->arguments[i]);
+                }
+                Text(")");
+            } break;
+            case Tag::Variable:
+                Text(term_cast<Variable>(t)->name);
+                break;
+            case Tag::CppTerm:
+                Text(fmt::format("cpp#{}", term_cast<CppTerm>(t)->id));
+                break;
+            case Tag::StringLiteral:
+                Text(QuoteStringForCLiteral(term_cast<StringLiteral>(t)->value.c_str()));
+                break;
+            case Tag::NumericLiteral: {
+                auto& n = term_cast<NumericLiteral>(t)->value;
+                if (n.kind == Number::Kind::NaN) {
+                    Text("NaN");
+                } else if (n.GetRational().denominator == 1) {
+                    Text(fmt::format("{}", n.GetRational().numerator));
+                } else {
+                    Text(fmt::format("{}/{}", n.GetRational().numerator,
+                                     n.GetRational().denominator));
+                }
+            } break;
+            case Tag::UnitLikeValue:
+                Text("unit_like ");
+                Operand(term_cast<UnitLikeValue>(t)->type);
+                break;
+            case Tag::DeferredValue: {
+                auto u = term_cast<DeferredValue>(t);
+                Text(u->availability == DeferredValue::Availability::Comptime
+                         ? "deferred_comptime "
+                         : "deferred_runtime ");
+                Operand(u->type);
+            } break;
+            case Tag::ProductValue: {
+                auto u = term_cast<ProductValue>(t);
+                WriteNamedTerms(u->values, " = ");
+                Text(": ");
+                Operand(u->type);
+            } break;
+            case Tag::SimpleTypeTerm:
+                Text(SimpleTypeName(term_cast<SimpleTypeTerm>(t)->simple_type));
+                break;
+            case Tag::NamedType: {
+                auto u = term_cast<NamedType>(t);
+                Text("named ");
+                Text(u->name);
+                if (u->type_constructor) {
+                    Text(" ");
+                    Operand(u->type_constructor);
+                }
+            } break;
+            case Tag::FunctionType: {
+                auto u = term_cast<FunctionType>(t);
+                if (!u->forall_variables.empty()) {
+                    WriteForall(u->forall_variables);
+                }
+                Text("(");
+                for (size_t i = 0; i < u->parameter_types.size(); ++i) {
+                    auto& p = u->parameter_types[i];
+                    if (i > 0) {
+                        Text(", ");
+                    }
+                    if (p.comptime_parameter) {
+                        Text("comptime ");
+                        Text((*p.comptime_parameter)->name);
+                        Text(": ");
+                    }
+                    Reference(p.type);
+                }
+                Text(") -> ");
+                Reference(u->return_type);
+            } break;
+            case Tag::TypeOfAbstraction:
+                Text("typeof ");
+                Operand(term_cast<TypeOfAbstraction>(t)->abstraction);
+                break;
+            case Tag::ProductType:
+                WriteNamedTerms(term_cast<ProductType>(t)->members, ": ");
+                break;
+        }
+    }
+};
+
+vector<TermPtr> TermsOf(const vector<pair<string, TermPtr>>& roots)
+{
+    vector<TermPtr> terms;
+    for (auto& [name, term] : roots) {
+        terms.push_back(term);
+    }
+    return terms;
+}
+
+}  // namespace
+
+TermDagStats GetTermDagStats(const vector<TermPtr>& roots)
+{
+    return GetStats(TermDag(roots), roots);
+}
+
+TermDagStats PrintTermDag(const vector<pair<string, TermPtr>>& roots, IndentedLinesWriter& writer)
+{
+    auto terms = TermsOf(roots);
+    TermDag dag(terms);
+    Printer printer;
+    // In post-order a shared term is defined before the first term referring to it.
+    for (auto t : dag.post_order) {
+        if (dag.IsShared(t)) {
+            auto definition = printer.Definition(t);
+            printer.AddName(t);
+            writer.Write(fmt::format("{} = {}", printer.NameOf(t), definition));
+            writer.EndLine();
+        }
+    }
+    for (auto& [name, term] : roots) {
+        auto definition = dag.IsShared(term) ? printer.NameOf(term) : printer.Definition(term);
+        writer.Write(name.empty() ? definition : fmt::format("{} = {}", name, definition));
+        writer.EndLine();
+    }
+    return GetStats(dag, terms);
+}
+
+string FormatTermDag(TermPtr term)
+{
+    string s;
+    {
+        IndentedLinesWriter writer(&s);
+        PrintTermDag({{string(), term}}, writer);
+    }
+    return s;
+}
+
+}  // namespace snl
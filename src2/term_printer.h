@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+#include "indented_lines.h"
+#include "term.h"
+
+#include <cstdint>
+
+namespace snl {
+
+// Canonical terms are hash-consed, a subterm referred to from many places is stored once. Printed
+// as a tree, a term can be exponentially larger than in the Store.
+struct TermDagStats
+{
+    size_t dag_size = 0;     // Distinct terms.
+    uint64_t tree_size = 0;  // Terms when printed as trees, saturates at UINT64_MAX.
+    size_t n_shared = 0;     // Terms printed once under a generated name.
+};
+
+TermDagStats GetTermDagStats(const vector<TermPtr>& roots);
+
+// Prints `<name> = <term>` for each root (just the term if the name is empty). A subterm referred
+// to more than once (except variables, literals and simple types) is printed once, on its own
+// `%<n> = <term>` line before the first line referring to it, and is referred to as `%<n>`.
+TermDagStats PrintTermDag(const vector<pair<string, TermPtr>>& roots, IndentedLinesWriter& writer);
+string FormatTermDag(TermPtr term);
+
+}  // namespace snl
@@ -101,85 +101,102 @@ ValueContent& Content(Value& value)
     return value.content->content;
 }
 
-IndentedLines Value::ToIndentedLines() const
+namespace {
+
+// True if the value is written on a single line: a product or vector is collapsed to a single
+// line when its only item is.
+bool IsOneLine(const Value& value)
 {
     return switch_variant(
-        content->content,
-        [this](const BuiltInValue& v) {
-            auto value = switch_variant(
-                v.value, [](monostate) -> string { return string(); },
-                [](const string& s) -> string { return QuoteStringForCLiteral(s.c_str()); });
-            return IndentedLines({fmt::format("{} :: {}", value, type->name)});
+        Content(value), [](const BuiltInValue&) { return true; },
+        [](const UnionValue& v) { return IsOneLine(v.value); },
+        [](const ProductValue& v) {
+            return v.fields.size() <= 1 &&
+                   (v.fields.empty() || IsOneLine(v.fields.begin()->second));
+        },
+        [](const VectorValue& v) {
+            return v.values.size() <= 1 && (v.values.empty() || IsOneLine(v.values.front()));
+        });
+}
+
+void WriteValue(const Value& value, IndentedLinesWriter& w);
+
+// Writes the items of a product or vector value. `write_label(index, item)` writes the label of
+// an item and `value_of(item)` returns its value.
+template <class Items, class WriteLabel, class ValueOf>
+void WriteItems(const Items& items,
+                const string& type_name,
+                WriteLabel write_label,
+                ValueOf value_of,
+                IndentedLinesWriter& w)
+{
+    if (items.empty()) {
+        w.Write("{}::");
+        w.Write(type_name);
+    } else if (items.size() == 1 && IsOneLine(value_of(*items.begin()))) {
+        w.Write("{ ");
+        write_label(0, *items.begin());
+        w.Write(": ");
+        WriteValue(value_of(*items.begin()), w);
+        w.Write(" }::");
+        w.Write(type_name);
+    } else {
+        w.Write("{");
+        w.EndLine();
+        w.Indent();
+        size_t index = 0;
+        for (auto& item : items) {
+            write_label(index++, item);
+            w.Write(": ");
+            WriteValue(value_of(item), w);
+            w.EndLine();
+        }
+        w.Dedent();
+        w.Write("}::");
+        w.Write(type_name);
+    }
+}
+
+// Writes the value but leaves its last line open.
+void WriteValue(const Value& value, IndentedLinesWriter& w)
+{
+    const string& type_name = value.type->name;
+    switch_variant(
+        Content(value),
+        [&w, &type_name](const BuiltInValue& v) {
+            switch_variant(
+                v.value, [](monostate) {},
+                [&w](const string& s) { w.Write(QuoteStringForCLiteral(s.c_str())); });
+            w.Write(" :: ");
+            w.Write(type_name);
         },
-        [](const UnionValue& v) { return v.value.ToIndentedLines(); },
-        [this](const ProductValue& v) {
-            if (v.fields.empty()) {
-                return IndentedLines({fmt::format("{{}}::{}", type->name)});
-            } else {
-                IndentedLines lines = {"{", ChangeIndentation::Indent};
-                bool first = true;
-                for (const auto& [field_name, field_value] : v.fields) {
-                    auto lines_of_value = field_value.ToIndentedLines();
-                    assert(!lines_of_value.empty());
-                    if (first) {
-                        first = false;
-                        if (v.fields.size() == 1 && lines_of_value.size() == 1 &&
-                            holds_alternative<string>(lines_of_value.front())) {
-                            return IndentedLines({fmt::format(
-                                "{{ {}: {} }}::{}", field_name,
-                                std::get<string>(lines_of_value.front()), type->name)});
-                        }
-                    }
-                    auto b = lines_of_value.begin();
-                    auto e = lines_of_value.end();
-                    if (b != e && holds_alternative<string>(*b)) {
-                        lines.emplace_back(fmt::format("{}: {}", field_name, std::get<string>(*b)));
-                        ++b;
-                    } else {
-                        lines.emplace_back(fmt::format("{}:", field_name));
-                    }
-                    lines.insert(lines.end(), make_move_iterator(b), make_move_iterator(e));
-                }
-                lines.emplace_back(ChangeIndentation::Dedent);
-                lines.emplace_back(fmt::format("}}::{}", type->name));
-                return lines;
-            }
+        [&w](const UnionValue& v) { WriteValue(v.value, w); },
+        [&w, &type_name](const ProductValue& v) {
+            WriteItems(
+                v.fields, type_name,
+                [&w](size_t, const auto& field) { w.Write(field.first); },
+                [](const auto& field) -> const Value& { return field.second; }, w);
         },
-        [this](const VectorValue& v) {
-            if (v.values.empty()) {
-                return IndentedLines({fmt::format("{{}}::{}", type->name)});
-            } else {
-                IndentedLines lines = {"{", ChangeIndentation::Indent};
-                bool first = true;
-                for (size_t index = 0; index < v.values.size(); ++index) {
-                    auto lines_of_value = v.values[index].ToIndentedLines();
-                    assert(!lines_of_value.empty());
-                    if (first) {
-                        first = false;
-                        if (v.values.size() == 1 && lines_of_value.size() == 1 &&
-                            holds_alternative<string>(lines_of_value.front())) {
-                            return IndentedLines({fmt::format(
-                                "{{ [0]: {} }}::{}", std::get<string>(lines_of_value.front()),
-                                type->name)});
-                        }
-                    }
-                    auto b = lines_of_value.begin();
-                    auto e = lines_of_value.end();
-                    if (b != e && holds_alternative<string>(*b)) {
-                        lines.emplace_back(fmt::format("[{}]: {}", index, std::get<string>(*b)));
-                        ++b;
-                    } else {
-                        lines.emplace_back(fmt::format("[{}]:", index));
-                    }
-                    lines.insert(lines.end(), make_move_iterator(b), make_move_iterator(e));
-                }
-                lines.emplace_back(ChangeIndentation::Dedent);
-                lines.emplace_back(fmt::format("}}::{}", type->name));
-                return lines;
-            }
+        [&w, &type_name](const VectorValue& v) {
+            WriteItems(
+                v.values, type_name,
+                [&w](size_t index, const Value&) {
+                    w.Write("[");
+                    w.Write(to_string(index));
+                    w.Write("]");
+                },
+                [](const Value& item) -> const Value& { return item; }, w);
         });
 }
 
+}  // namespace
+
+void Value::WriteIndentedLines(IndentedLinesWriter& writer) const
+{
+    WriteValue(*this, writer);
+    writer.EndLine();
+}
+
 optional<const Value*> Value::Select(const std::string member_name) const
 {
     if (auto* p = std::get_if<UnionValue>(&content->content)) {
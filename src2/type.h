@@ -65,7 +65,8 @@ struct Value
     optional<const Value*> AtIndex(int i) const;                         // For Vector
 
     const ValueContentWrapper& Content() const;
-    IndentedLines ToIndentedLines() const;
+    // Continues the current line of `writer` and ends the last line of the value.
+    void WriteIndentedLines(IndentedLinesWriter& writer) const;
 };
 
 struct BuiltInValue